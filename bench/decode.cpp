@@ -0,0 +1,175 @@
+#include "config.hpp"
+#include "MicroOp.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+// Decode throughput of the table-driven decoder (DecodeTable.hpp) against
+// the nested switch it replaced, kept below as the baseline. Every word of
+// the given images is decoded, code and data alike, so the mix includes
+// invalid encodings.
+//
+//   bench_decode [--reps=N] [program.data ...]
+//
+// defaults to every data/*.data the simulator ships with.
+
+namespace {
+  using InstTag::ID;
+
+  /// the hand-written decoder as it was before DecodeTable, fall-through included
+  auto SwitchDecodeKind(const u32 encoding) -> ID {
+    #define RET(mnemonic) return ID::mnemonic
+    #define CASE(mnemonic, type) case InstTag::mnemonic::type: RET(mnemonic)
+    switch (GetOpcode(encoding)) {
+    case InstTag::ALU_ri::opcode:
+      switch (GetFunct3(encoding)) {
+        CASE(ADDI,  funct3);
+        CASE(SLTI,  funct3);
+        CASE(SLTIU, funct3);
+        CASE(ANDI,  funct3);
+        CASE(ORI,   funct3);
+        CASE(XORI,  funct3);
+        CASE(SLLI,  funct3);
+      case 0b101:
+        if (getbits<30>(encoding) == 0) RET(SRLI);
+        else RET(SRAI);
+      }
+      [[fallthrough]];
+    CASE(LUI,   opcode);
+    CASE(AUIPC, opcode);
+    case InstTag::ALU_rr::opcode:
+      switch (GetFunct3(encoding)) {
+        CASE(SLT,  funct3);
+        CASE(SLTU, funct3);
+        CASE(AND,  funct3);
+        CASE(OR,   funct3);
+        CASE(XOR,  funct3);
+        CASE(SLL,  funct3);
+      case 0b000:
+        switch (GetFunct7(encoding)) {
+          CASE(ADD, funct7);
+          CASE(SUB, funct7);
+        }
+        [[fallthrough]];
+      case 0b101:
+        switch (GetFunct7(encoding)) {
+          CASE(SRL, funct7);
+          CASE(SRA, funct7);
+        }
+      }
+      [[fallthrough]];
+    CASE(JAL,  opcode);
+    CASE(JALR, opcode);
+    case InstTag::BranchCC_rri::opcode:
+      switch (GetFunct3(encoding)) {
+        CASE(BEQ,  funct3);
+        CASE(BNE,  funct3);
+        CASE(BLT,  funct3);
+        CASE(BLTU, funct3);
+        CASE(BGE,  funct3);
+        CASE(BGEU, funct3);
+      }
+      [[fallthrough]];
+    case InstTag::Load_ri::opcode:
+      switch (GetFunct3(encoding)) {
+        CASE(LB,  funct3);
+        CASE(LH,  funct3);
+        CASE(LW,  funct3);
+        CASE(LBU, funct3);
+        CASE(LHU, funct3);
+      }
+      [[fallthrough]];
+    case InstTag::Store_rri::opcode:
+      switch (GetFunct3(encoding)) {
+        CASE(SB, funct3);
+        CASE(SH, funct3);
+        CASE(SW, funct3);
+      }
+    }
+    RET(Unknown);
+    #undef CASE
+    #undef RET
+  }
+
+  /// one timed pass over `words`, in ms
+  template <typename Decode>
+  auto pass(const std::vector<u32> &words, Decode &&decode) -> f64 {
+    u64 sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < words.size(); ++i)
+      sink += decode(words[i], i << 2);
+    const auto end = std::chrono::steady_clock::now();
+    if (sink == 42)
+      LOG("\n");  // keep the decodes alive
+    return std::chrono::duration<f64, std::milli>(end - start).count();
+  }
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  u32 reps = 20;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--reps=", 0) == 0)
+      reps = std::max(1, std::stoi(arg.substr(7)));
+    else
+      files.push_back(arg);
+  }
+  if (files.empty())
+    for (const char *name : {"array_test1", "array_test2", "basicopt1", "bulgarian", "expr", "gcd", "hanoi",
+                             "lvalue2", "magic", "manyarguments", "multiarray", "naive", "pi", "qsort",
+                             "queens", "statement_test", "superloop", "tak"})
+      files.push_back(std::string("data/") + name + ".data");
+
+  // every word of every image, repeated so one pass takes long enough to time
+  std::vector<u32> words;
+  auto memory = std::make_unique<Memory>();
+  for (const std::string &file : files) {
+    std::ifstream in(file);
+    if (!in) {
+      LOG("cannot open %s\n", file.c_str());
+      return 1;
+    }
+    memory->readfrom(in);
+    u32 used = CODE_SIZE;
+    while (used > 0 and memory->load<u8>(used - 1) == 0)
+      --used;
+    for (u32 address = 0; address < used; address += 4)
+      words.push_back(memory->load<u32>(address));
+  }
+  for (const std::size_t size = words.size(); words.size() < (4u << 20);)
+    words.insert(words.end(), words.begin(), words.begin() + static_cast<std::ptrdiff_t>(size));
+
+  u64 differ = 0;
+  for (const u32 word : words)
+    differ += SwitchDecodeKind(word) != DecodeKind(word);
+
+  // the variants take turns, so drift on a shared host hits all of them alike
+  f64 switchKind = 1e300, tableKind = 1e300, switchFull = 1e300, tableFull = 1e300;
+  for (u32 rep = 0; rep < reps; ++rep) {
+    switchKind = std::min(switchKind, pass(words, [](const u32 word, u32) {
+      return static_cast<u32>(SwitchDecodeKind(word));
+    }));
+    tableKind = std::min(tableKind, pass(words, [](const u32 word, u32) {
+      return static_cast<u32>(DecodeKind(word));
+    }));
+    switchFull = std::min(switchFull, pass(words, [](const u32 word, const u32 pc) {
+      const MicroOp op = MicroOp::Extract(SwitchDecodeKind(word), word, pc);
+      return op.imm + op.rd + op.rs1 + op.rs2 + static_cast<u32>(op.kind);
+    }));
+    tableFull = std::min(tableFull, pass(words, [](const u32 word, const u32 pc) {
+      const MicroOp op = MicroOp::Decode(word, pc);
+      return op.imm + op.rd + op.rs1 + op.rs2 + static_cast<u32>(op.kind);
+    }));
+  }
+
+  const auto rate = [&](const f64 ms) { return (f64)words.size() / ms / 1e3; };
+  printf("%zu words, %llu decoded to a different kind by the switch\n", words.size(), differ);
+  printf("%-22s %10s %10s %10s %8s\n", "", "switch ms", "table ms", "Mdecode/s", "speedup");
+  printf("%-22s %10.3lf %10.3lf %10.1lf %7.2lfx\n", "kind only", switchKind, tableKind, rate(tableKind), switchKind / tableKind);
+  printf("%-22s %10.3lf %10.3lf %10.1lf %7.2lfx\n", "full micro-op", switchFull, tableFull, rate(tableFull), switchFull / tableFull);
+  printf("%-22s %10.1lf Mdecode/s (kind only), %.1lf Mdecode/s (full micro-op)\n", "switch",
+    rate(switchKind), rate(switchFull));
+  return 0;
+}
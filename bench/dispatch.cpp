@@ -0,0 +1,77 @@
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+// Compares instruction dispatch of the functional engine (a switch over the
+// micro-op kind per instruction) with the threaded-code engine and the
+// chained basic-block engine. Loading the image is excluded from the
+// timings; speedups are relative to the switch dispatch.
+//
+//   bench_dispatch [--reps=N] [program.data ...]
+//
+// defaults to data/pi.data and data/bulgarian.data.
+
+namespace {
+  struct Sample {
+    u32 ret;
+    u64 instret;
+    f64 ms;
+  };
+
+  auto measure(const std::string &image, const Engine engine, const u32 reps) -> Sample {
+    Sample best{0, 0, 1e300};
+    for (u32 rep = 0; rep < reps; ++rep) {
+      auto executor = std::make_unique<Executor>();
+      std::istringstream input(image);
+      executor->initMem(input);
+
+      const auto start = std::chrono::steady_clock::now();
+      const u32 ret = executor->run(engine);
+      const auto end = std::chrono::steady_clock::now();
+
+      const f64 ms = std::chrono::duration<f64, std::milli>(end - start).count();
+      if (ms < best.ms)
+        best = Sample{ret, executor->instret, ms};
+    }
+    return best;
+  }
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  u32 reps = 5;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--reps=", 0) == 0)
+      reps = std::max(1, std::stoi(arg.substr(7)));
+    else
+      files.push_back(arg);
+  }
+  if (files.empty())
+    files = {"data/pi.data", "data/bulgarian.data"};
+
+  printf("%-24s %-11s %6s %12s %10s %8s  %s\n", "program", "engine", "ret", "instructions", "best (ms)", "MIPS", "speedup");
+  for (const std::string &file : files) {
+    std::ifstream in(file);
+    if (!in) {
+      LOG("cannot open %s\n", file.c_str());
+      return 1;
+    }
+    const std::string image{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    const Sample base = measure(image, Engine::Functional, reps);
+    for (const auto &[name, engine] : {std::pair{"threaded", Engine::Threaded}, std::pair{"block", Engine::Block}}) {
+      const Sample sample = measure(image, engine, reps);
+      if (engine == Engine::Threaded)
+        printf("%-24s %-11s %6u %12llu %10.3lf %8.1lf\n", file.c_str(), "switch", base.ret,
+          base.instret, base.ms, (f64)base.instret / base.ms / 1e3);
+      printf("%-24s %-11s %6u %12llu %10.3lf %8.1lf  %.2lfx%s\n", file.c_str(), name, sample.ret,
+        sample.instret, sample.ms, (f64)sample.instret / sample.ms / 1e3, base.ms / sample.ms,
+        base.ret == sample.ret ? "" : "  (RETURN VALUES DIFFER)");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include "config.hpp"
+#include "Executor.hpp"
+#include "Intervals.hpp"
+#include "Batch.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Interval simulation (Intervals.hpp) against a serial pipeline run of the
+// same program: the error of the stitched cycle count and prediction
+// accuracy, and the speedup for each number of worker threads. Workers
+// reload the predictor from their checkpoint, so the stitched numbers do not
+// depend on the thread count; a run that differs from the one-thread run is
+// counted as a mismatch.
+//
+//   bench_intervals [--length=N] [--warmup=N] [--threads=1,2,4] [program.data ...]
+//
+// defaults to every data/*.data the simulator ships with, and to powers of
+// two up to the host's cores (at least 1, 2 and 4).
+
+namespace {
+  auto load(const std::string &file) -> std::unique_ptr<Executor> {
+    auto executor = std::make_unique<Executor>();
+    const std::optional<ImageText> text = ImageText::open(file.c_str());
+    if (!text or !executor->initMem(*text))
+      return nullptr;
+    return executor;
+  }
+
+  auto millisecondsSince(const std::chrono::steady_clock::time_point start) -> f64 {
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  auto percent(const f64 value, const f64 truth) -> f64 {
+    return truth == 0 ? 0 : 100.0 * (value - truth) / truth;
+  }
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  IntervalOptions options;
+  std::vector<u32> threads;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--length=", 0) == 0)
+      options.length = std::max(1ull, std::stoull(arg.substr(9)));
+    else if (arg.rfind("--warmup=", 0) == 0)
+      options.warmup = std::stoull(arg.substr(9));
+    else if (arg.rfind("--threads=", 0) == 0) {
+      std::istringstream list(arg.substr(10));
+      for (std::string count; std::getline(list, count, ',');)
+        threads.push_back(static_cast<u32>(std::max(1, std::stoi(count))));
+    } else
+      files.push_back(arg);
+  }
+  if (threads.empty())
+    for (u32 count = 1; count <= std::max(DefaultJobs(), 4u); count *= 2)
+      threads.push_back(count);
+  if (files.empty())
+    for (const char *name : {"array_test1", "array_test2", "basicopt1", "bulgarian", "expr", "gcd", "hanoi",
+                             "lvalue2", "magic", "manyarguments", "multiarray", "naive", "pi", "qsort",
+                             "queens", "statement_test", "superloop", "tak"})
+      files.push_back(std::string("data/") + name + ".data");
+  for (const std::string &file : files)
+    if (!std::ifstream(file)) {
+      LOG("cannot open %s\n", file.c_str());
+      return 1;
+    }
+
+  printf("intervals of %llu instructions, warm-up %llu; %u host cores; errors in %%, speedup over the serial run\n",
+    options.length, options.warmup, DefaultJobs());
+  printf("%-20s %9s %12s %8s %8s %10s", "program", "intervals", "cycles", "err", "acc err", "serial ms");
+  for (const u32 count : threads)
+    printf(" %6u thr", count);
+  printf("\n");
+
+  u32 wrong = 0;
+  f64 serialMs = 0;
+  std::vector<f64> intervalMs(threads.size());
+  for (const std::string &file : files) {
+    const std::unique_ptr<Executor> serial = load(file);
+    if (!serial) {
+      LOG("cannot load %s\n", file.c_str());
+      return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const u32 ret = serial->run(Engine::Pipeline);
+    const f64 ms = millisecondsSince(start);
+    serialMs += ms;
+
+    std::vector<IntervalRun> runs;
+    std::vector<f64> speedups;
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+      const std::unique_ptr<Executor> executor = load(file);
+      options.jobs = threads[i];
+      const auto runStart = std::chrono::steady_clock::now();
+      runs.push_back(RunIntervals(*executor, options));
+      const f64 runMs = millisecondsSince(runStart);
+      intervalMs[i] += runMs;
+      speedups.push_back(ms / runMs);
+      const IntervalRun &run = runs.back();
+      wrong += run.faulted or run.ret != ret or run.instret != serial->instret
+        or run.cycles != runs[0].cycles or run.hits != runs[0].hits or run.predictions != runs[0].predictions;
+    }
+
+    const std::string name = file.substr(file.find_last_of('/') + 1);
+    printf("%-20s %9llu %12llu %+8.3lf %+8.3lf %10.1lf", name.c_str(), runs[0].intervals, runs[0].cycles,
+      percent((f64)runs[0].cycles, (f64)serial->cycles),
+      percent(runs[0].accuracy(), serial->predictor.hitRate()), ms);
+    for (const f64 speedup : speedups)
+      printf(" %9.2lfx", speedup);
+    printf("\n");
+  }
+  printf("%-20s %9s %12s %8s %8s %10.1lf", "all", "", "", "", "", serialMs);
+  for (const f64 ms : intervalMs)
+    printf(" %9.2lfx", serialMs / ms);
+  printf("\n%u runs mismatched the serial run or the one-thread run\n", wrong);
+  return wrong == 0 ? 0 : 1;
+}
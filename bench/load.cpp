@@ -0,0 +1,185 @@
+#include "config.hpp"
+#include "Memory.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+// Load time of the mapped, vectorized image loader (Image.hpp) and of
+// snapshots (Snapshot.hpp) against the getline/stringstream parser they
+// replaced, kept below as the baseline. All of them read each file from disk
+// on every pass, so the times include opening it. The baseline parses into a
+// flat 128 KiB array it zeroes first, as Memory did before it was paged; the
+// others load into a Memory they clear first, as Memory::readfrom does. A
+// synthetic image filling 128 KiB is added to show throughput on something
+// larger than the test programs.
+//
+//   bench_load [--reps=N] [program.data ...]
+//
+// defaults to every data/*.data the simulator ships with.
+
+namespace {
+  /// Memory::readfrom as it was before Image.hpp
+  auto StreamParse(std::istream &input, u8 *mem) -> void {
+    std::string buf;
+    u8 *pos = mem; u32 value;
+    while (std::getline(input, buf)) {
+      if (buf[0] == '@') {
+        pos = mem + std::stoi(buf.substr(1), nullptr, 16);
+      } else {
+        std::stringstream ss(buf); ss << std::hex;
+        while (ss >> value) {
+          *pos++ = static_cast<u8>(value);
+        }
+      }
+    }
+  }
+
+  constexpr u32 FlatSize = 0x20000;  // the memory size before paging
+
+  /// one timed pass over `files`, in ms
+  template <typename Load>
+  auto pass(const std::vector<std::string> &files, Load &&load) -> f64 {
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string &file : files)
+      load(file);
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  auto streamLoad(const std::string &file, u8 *flat) -> void {
+    std::memset(flat, 0, FlatSize);
+    std::ifstream input(file);
+    StreamParse(input, flat);
+  }
+
+  auto imageLoad(const std::string &file, Memory &mem) -> void {
+    mem.clear();
+    const std::optional<ImageText> text = ImageText::open(file.c_str());
+    ParseImage(text->begin, text->end, mem);
+  }
+
+  auto snapshotLoad(const std::string &file, Memory &mem) -> void {
+    mem.clear();
+    const std::optional<ImageText> text = ImageText::open(file.c_str());
+    LoadSnapshot(text->begin, text->end, mem);
+  }
+
+  /// the snapshot of the text image `file`, next to it in /tmp
+  auto snapshotOf(const std::string &file, Memory &mem) -> std::string {
+    imageLoad(file, mem);
+    const std::string path = "/tmp/bench_load_" + std::to_string(getpid()) + "_"
+      + file.substr(file.find_last_of('/') + 1) + ".snap";
+    std::ofstream(path, std::ios::binary) << WriteSnapshot(mem, 0);
+    return path;
+  }
+
+  /// `mem` holds the bytes of `flat` and nothing past them
+  auto same(const u8 *flat, const Memory &mem) -> bool {
+    auto copy = std::make_unique<u8[]>(FlatSize);
+    mem.read(0, copy.get(), FlatSize);
+    return std::memcmp(flat, copy.get(), FlatSize) == 0 and mem.footprint() <= FlatSize;
+  }
+
+  auto fileSize(const std::string &file) -> u64 {
+    std::ifstream input(file, std::ios::binary | std::ios::ate);
+    return static_cast<u64>(input.tellg());
+  }
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  u32 reps = 20;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--reps=", 0) == 0)
+      reps = std::max(1, std::stoi(arg.substr(7)));
+    else
+      files.push_back(arg);
+  }
+  if (files.empty())
+    for (const char *name : {"array_test1", "array_test2", "basicopt1", "bulgarian", "expr", "gcd", "hanoi",
+                             "lvalue2", "magic", "manyarguments", "multiarray", "naive", "pi", "qsort",
+                             "queens", "statement_test", "superloop", "tak"})
+      files.push_back(std::string("data/") + name + ".data");
+  for (const std::string &file : files)
+    if (!std::ifstream(file)) {
+      LOG("cannot open %s\n", file.c_str());
+      return 1;
+    }
+
+  // pseudo-random bytes over all of memory, 16 to a line as the toolchain writes them
+  char synthetic[] = "/tmp/bench_load_XXXXXX";
+  const i32 fd = mkstemp(synthetic);
+  if (fd < 0) {
+    LOG("cannot create %s\n", synthetic);
+    return 1;
+  }
+  {
+    std::ofstream output(synthetic);
+    output << "@00000000\n";
+    u32 state = 1;
+    for (u32 address = 0; address < FlatSize; ++address) {
+      state = state * 1664525u + 1013904223u;
+      char token[4];
+      std::snprintf(token, sizeof token, "%02X ", state >> 24);
+      output << token << ((address & 15) == 15 ? "\n" : "");
+    }
+  }
+  close(fd);
+
+  auto flat = std::make_unique<u8[]>(FlatSize + 64);
+  auto mem = std::make_unique<Memory>();
+  const auto stream = [&](const std::string &file) { streamLoad(file, flat.get()); };
+  const auto image = [&](const std::string &file) { imageLoad(file, *mem); };
+  const auto snapshot = [&](const std::string &file) { snapshotLoad(file, *mem); };
+
+  u64 differ = 0;
+  std::vector<std::string> all = files, snapshots;
+  all.push_back(synthetic);
+  for (const std::string &file : all) {
+    snapshots.push_back(snapshotOf(file, *mem));
+    stream(file);
+    image(file);
+    differ += !same(flat.get(), *mem);
+    snapshot(snapshots.back());
+    differ += !same(flat.get(), *mem);
+  }
+
+  // the variants take turns, so drift on a shared host hits them alike
+  const std::vector<std::string> big{synthetic}, bigSnapshot{snapshots.back()};
+  const std::vector<std::string> smallSnapshots(snapshots.begin(), snapshots.end() - 1);
+  f64 streamSmall = 1e300, imageSmall = 1e300, snapshotSmall = 1e300;
+  f64 streamBig = 1e300, imageBig = 1e300, snapshotBig = 1e300;
+  for (u32 rep = 0; rep < reps; ++rep) {
+    streamSmall = std::min(streamSmall, pass(files, stream));
+    imageSmall = std::min(imageSmall, pass(files, image));
+    snapshotSmall = std::min(snapshotSmall, pass(smallSnapshots, snapshot));
+    streamBig = std::min(streamBig, pass(big, stream));
+    imageBig = std::min(imageBig, pass(big, image));
+    snapshotBig = std::min(snapshotBig, pass(bigSnapshot, snapshot));
+  }
+  u64 smallBytes = 0, smallSnapshotBytes = 0;
+  for (const std::string &file : files)
+    smallBytes += fileSize(file);
+  for (const std::string &file : smallSnapshots)
+    smallSnapshotBytes += fileSize(file);
+  const u64 bigBytes = fileSize(synthetic), bigSnapshotBytes = fileSize(bigSnapshot[0]);
+  std::remove(synthetic);
+  for (const std::string &file : snapshots)
+    std::remove(file.c_str());
+
+  printf("%zu images, %llu loaded differently from the stream parser\n", all.size(), differ);
+  printf("%-22s %10s %10s %10s %9s %9s %12s\n", "", "stream ms", "image ms", "snap ms",
+    "image x", "snap x", "bytes/snap");
+  printf("%-22s %10.3lf %10.3lf %10.3lf %8.2lfx %8.2lfx %6llu/%llu\n", "programs (per pass)",
+    streamSmall, imageSmall, snapshotSmall, streamSmall / imageSmall, streamSmall / snapshotSmall,
+    smallBytes, smallSnapshotBytes);
+  printf("%-22s %10.3lf %10.3lf %10.3lf %8.2lfx %8.2lfx %6llu/%llu\n", "128 KiB image",
+    streamBig, imageBig, snapshotBig, streamBig / imageBig, streamBig / snapshotBig, bigBytes, bigSnapshotBytes);
+  return differ == 0 ? 0 : 1;
+}
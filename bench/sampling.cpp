@@ -0,0 +1,105 @@
+#include "config.hpp"
+#include "Executor.hpp"
+#include "Sampling.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Sampled simulation (Sampling.hpp) against a full pipeline run of the same
+// program: estimated cycles, CPI and branch accuracy with their 95%
+// intervals, the error of each estimate, whether the interval covers the
+// true value, and the speedup. Programs shorter than one period get no
+// samples and are listed without estimates.
+//
+//   bench_sampling [--period=N] [--warmup=N] [--window=N] [program.data ...]
+//
+// defaults to every data/*.data the simulator ships with.
+
+namespace {
+  auto load(const std::string &file) -> std::unique_ptr<Executor> {
+    auto executor = std::make_unique<Executor>();
+    const std::optional<ImageText> text = ImageText::open(file.c_str());
+    if (!text or !executor->initMem(*text))
+      return nullptr;
+    return executor;
+  }
+
+  auto millisecondsSince(const std::chrono::steady_clock::time_point start) -> f64 {
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  /// relative error of `estimate` in percent, and whether its interval covers `truth`
+  auto judge(const Estimate &estimate, const f64 truth) -> std::pair<f64, bool> {
+    const f64 error = truth == 0 ? 0 : 100.0 * (estimate.value - truth) / truth;
+    return {error, std::fabs(estimate.value - truth) <= estimate.error};
+  }
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  SamplingOptions options;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--period=", 0) == 0)
+      options.period = std::max(1ull, std::stoull(arg.substr(9)));
+    else if (arg.rfind("--warmup=", 0) == 0)
+      options.warmup = std::stoull(arg.substr(9));
+    else if (arg.rfind("--window=", 0) == 0)
+      options.window = std::max(1ull, std::stoull(arg.substr(9)));
+    else
+      files.push_back(arg);
+  }
+  if (files.empty())
+    for (const char *name : {"array_test1", "array_test2", "basicopt1", "bulgarian", "expr", "gcd", "hanoi",
+                             "lvalue2", "magic", "manyarguments", "multiarray", "naive", "pi", "qsort",
+                             "queens", "statement_test", "superloop", "tak"})
+      files.push_back(std::string("data/") + name + ".data");
+  for (const std::string &file : files)
+    if (!std::ifstream(file)) {
+      LOG("cannot open %s\n", file.c_str());
+      return 1;
+    }
+
+  printf("period %llu instructions, warm-up %llu and window %llu cycles; errors in %%, * = outside the 95%% interval\n",
+    options.period, options.warmup, options.window);
+  printf("%-20s %7s %12s %8s %15s %8s %15s %8s %7s %8s\n", "program", "samples", "cycles", "err", "CPI", "err",
+    "accuracy", "err", "detail", "speedup");
+  u32 wrong = 0;
+  f64 fullMs = 0, sampledMs = 0;
+  for (const std::string &file : files) {
+    const std::unique_ptr<Executor> full = load(file), sampled = load(file);
+    if (!full or !sampled) {
+      LOG("cannot load %s\n", file.c_str());
+      return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    const u32 ret = full->run(Engine::Pipeline);
+    const f64 ms = millisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    const SampledRun run = RunSampled(*sampled, options);
+    const f64 sampleMs = millisecondsSince(start);
+    fullMs += ms, sampledMs += sampleMs;
+
+    const std::string name = file.substr(file.find_last_of('/') + 1);
+    wrong += run.faulted or full->mem.fault or run.ret != ret or run.instret != full->instret;
+    if (run.samples == 0) {
+      printf("%-20s %7s %12llu %8s %15.4lf %8s %15.4lf %8s %7s %7.2lfx\n", name.c_str(), "-", full->cycles, "",
+        (f64)full->cycles / (f64)full->instret, "", full->predictor.hitRate(), "", "", ms / sampleMs);
+      continue;
+    }
+    const auto [cyclesError, cyclesCovered] = judge(run.cycles(), (f64)full->cycles);
+    const auto [cpiError, cpiCovered] = judge(run.cpi, (f64)full->cycles / (f64)full->instret);
+    const auto [accuracyError, accuracyCovered] = judge(run.accuracy, full->predictor.hitRate());
+    printf("%-20s %7llu %12.0lf %+7.2lf%c %7.4lf+-%6.4lf %+7.2lf%c %7.4lf+-%6.4lf %+7.2lf%c %6.1lf%% %7.2lfx\n",
+      name.c_str(), run.samples, run.cycles().value, cyclesError, cyclesCovered ? ' ' : '*', run.cpi.value,
+      run.cpi.error, cpiError, cpiCovered ? ' ' : '*', run.accuracy.value, run.accuracy.error, accuracyError,
+      accuracyCovered ? ' ' : '*',
+      100.0 * (f64)run.detailedCycles / (f64)full->cycles, ms / sampleMs);
+  }
+  printf("%u programs ended differently when sampled; %.1lfms full, %.1lfms sampled (%.2lfx)\n",
+    wrong, fullMs, sampledMs, fullMs / sampledMs);
+  return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <vector>
+
+/// outcome of one program of a batch
+struct BatchResult {
+  std::string file;
+  bool loaded;    // false if the file could not be opened or is not a runnable image
+  bool faulted;   // a guest fault stopped it; ret is then 0
+  u32 ret;        // exit value, as ./code prints it
+  u64 instret;    // instructions retired
+  f64 loadMs;     // wall time of mapping and parsing the image
+  f64 ms;         // wall time of the run, loading excluded (of the whole group, with lockstep)
+};
+
+struct BatchOptions {
+  Engine engine;
+  bool fuse;      // see Executor::fuse
+  bool lockstep;  // run LockstepLanes programs at a time in a LockstepGroup instead of an Executor each
+  u32 jobs;       // worker threads
+};
+
+/// run every program in `files` on a fresh Executor (or lane of a lockstep
+/// group), `jobs` of them at a time on a pool of worker threads. results come
+/// back in the order of `files`.
+auto RunBatch(const std::vector<std::string> &files, const BatchOptions &options) -> std::vector<BatchResult>;
+
+/// one worker per host core
+auto DefaultJobs() -> u32;
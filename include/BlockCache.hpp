@@ -0,0 +1,132 @@
+#pragma once
+
+#include "config.hpp"
+#include "InstTag.hpp"
+#include "Memory.hpp"
+#include "RegisterFile.hpp"
+#include "MicroOp.hpp"
+#include "ThreadedCode.hpp"
+
+#include <vector>
+
+struct JitContext;
+
+/// a translated basic block: straight-line code ending at a branch, a jump,
+/// MaxBlockLength instructions or just before the halt marker
+struct Block {
+  /// run one instruction at the given pc, return the next pc
+  using Step = auto (*)(MicroOp *, const u32, RegisterFile &, Memory &) -> u32;
+  /// compiled block (see Jit.hpp), returns the next pc
+  using NativeCode = auto (*)(JitContext *) -> u32;
+
+  struct Op {
+    Step step;
+    MicroOp *inst;      // decoded operands, owned by the decode cache
+  };
+
+  /// one chained successor: if the block exits to `pc`, continue with `block`
+  struct Link {
+    u32 pc;
+    Block *block;
+  };
+
+  u32 start, end;       // guest addresses [start, end) this block was translated from
+  bool halt;            // the block is the halt marker itself
+  std::vector<Op> ops;
+  Link fallthrough;     // end of block reached without jumping
+  Link taken;           // last jump target (fixed for branches / JAL, last target for JALR)
+  u32 heat;             // interpreted executions so far, used by the JIT
+  NativeCode native;    // compiled form, nullptr while interpreted
+
+  Block(const u32 at):
+    start(at), end(at), halt(false), ops{},
+    fallthrough{0, nullptr}, taken{0, nullptr}, heat(0), native(nullptr) {}
+
+  auto successor(const u32 pc) const -> Block * {
+    if (pc == fallthrough.pc and fallthrough.block)
+      return fallthrough.block;
+    if (pc == taken.pc and taken.block)
+      return taken.block;
+    return nullptr;
+  }
+
+  auto link(const u32 pc, Block *block) -> void {
+    if (pc == end)
+      fallthrough = Link{pc, block};
+    else
+      taken = Link{pc, block};
+  }
+};
+
+template <InstTag::ID Kind>
+auto BlockStep(MicroOp *inst, const u32 pc, RegisterFile &RF, Memory &mem) -> u32 {
+  return Retire<Kind>(inst, pc, RF, mem);
+}
+
+/// step function of every instruction, indexed by InstTag::ID
+#define GENSTEP(MNEMONIC, ...) &BlockStep<InstTag::ID::MNEMONIC>,
+inline constexpr Block::Step BlockSteps[InstTag::NumIDs] = {
+  RV32I_INSTTAGS(INSTTAG_IGNORE, GENSTEP, GENSTEP, GENSTEP, GENSTEP, GENSTEP, GENSTEP)
+  &BlockStep<InstTag::ID::Unknown>,
+};
+#undef GENSTEP
+
+/// translated blocks indexed by their start pc. A guest store to any word a
+/// block was translated from marks the cache dirty; the executor then drops
+/// every block (and with them every chain) at the next block boundary.
+struct BlockCache: MemoryObserver {
+  static constexpr u32 Capacity = CODE_SIZE >> 2;
+  static constexpr u32 MaxBlockLength = 64;
+
+  std::vector<std::unique_ptr<Block>> blocks;
+  std::unique_ptr<Block *[]> entry;   // block starting at each word
+  std::vector<u8> translated;         // words some block was translated from (read by compiled code,
+                                      // one spare entry so a store at the last word may probe the next)
+  bool dirty;
+
+  u64 translations, flushes;
+  u64 chained, dispatched;            // block transitions through a chain / through the lookup
+
+  BlockCache():
+    blocks{}, entry(std::make_unique<Block *[]>(Capacity)), translated(Capacity + 1, 0), dirty(false),
+    translations(0), flushes(0), chained(0), dispatched(0) {}
+  ~BlockCache() = default;
+
+  BlockCache(const BlockCache &) = delete;
+  auto operator= (const BlockCache &) -> BlockCache& = delete;
+
+  auto lookup(const u32 pc) const -> Block * {
+    return pc < CODE_SIZE ? entry[pc >> 2] : nullptr;
+  }
+
+  auto insert(std::unique_ptr<Block> block) -> Block * {
+    const u32 last = std::max(block->end, block->start + 4);
+    for (u32 address = block->start; address < last; address += 4)
+      translated[address >> 2] = 1;
+    entry[block->start >> 2] = block.get();
+    blocks.push_back(std::move(block));
+    ++translations;
+    return blocks.back().get();
+  }
+
+  auto flush() -> void {
+    for (const auto &block : blocks) {
+      entry[block->start >> 2] = nullptr;
+      const u32 last = std::max(block->end, block->start + 4);
+      for (u32 address = block->start; address < last; address += 4)
+        translated[address >> 2] = 0;
+    }
+    blocks.clear();
+    dirty = false;
+    ++flushes;
+  }
+
+  auto invalidate(const u32 address, const u32 size) -> void override {
+    if (size == 0 or address >= CODE_SIZE or blocks.empty())
+      return;
+    const u32 last = std::min(address + size - 1, CODE_SIZE - 1) >> 2;
+    for (u32 index = address >> 2; index <= last; ++index)
+      if (translated[index])
+        dirty = true;
+  }
+};
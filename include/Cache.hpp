@@ -0,0 +1,212 @@
+#pragma once
+
+#include "config.hpp"
+#include "Dram.hpp"
+
+#include <vector>
+
+/// a set-associative cache in front of memory, as the pipeline times it. It
+/// holds tags only: data always comes from Memory, so the cache decides how
+/// long an access takes and never what it reads.
+struct Cache {
+  /// a line of a set; `tag` is the line's address over lineSize
+  struct Line {
+    u64 lastUse;     // access count when the line was last touched, for LRU
+    u64 readyAt;     // cycle its fill completes; later than now while a prefetch is on its way
+    u32 tag;
+    u8 valid;
+    u8 dirty;
+    u8 prefetched;   // filled by a prefetch that no demand access has used yet
+    u8 pad;
+  };
+  static_assert(sizeof(Line) == 24);
+
+  /// what a demand access found, for the pipeline to wait on and a prefetcher to train on
+  struct Access {
+    u32 latency;     // cycles it takes
+    bool hit;
+    bool prefetchHit; // the first use of a prefetched line
+  };
+
+  CacheConfig config;
+  u32 lineBits, setMask;
+  std::vector<Line> lines;  // ways of set 0, then of set 1, ...
+  std::vector<u32> plru;    // tree bits of every set; node n is bit n, the root is 1
+  u64 accesses;
+  u32 seed;                 // state of the Random policy
+  u64 hits, misses, evictions, writebacks;
+  u64 prefetches;     // lines a prefetch filled
+  u64 usefulPrefetches, latePrefetches; // prefetched lines a demand access used, and found still on their way
+  u64 uselessPrefetches;                // prefetched lines evicted unused
+  Dram *dram;         // moves the lines in and out, with UseDram; else each transfer takes missLatency
+
+  explicit Cache(const CacheConfig &configured): config(configured), lineBits(Log2(configured.lineSize)),
+    setMask(Sets(configured) - 1), lines(Sets(configured) * configured.ways), plru(Sets(configured)), accesses(0),
+    seed(0x9e3779b9u), hits(0), misses(0), evictions(0), writebacks(0), prefetches(0), usefulPrefetches(0),
+    latePrefetches(0), uselessPrefetches(0), dram(nullptr) {}
+
+  static constexpr auto Sets(const CacheConfig &config) -> u32 {
+    return config.size / config.lineSize / config.ways;
+  }
+
+  static constexpr auto Log2(const u32 value) -> u32 {
+    u32 bits = 0;
+    while ((1u << bits) < value)
+      ++bits;
+    return bits;
+  }
+
+  /// `config` describes a cache this model can hold
+  static constexpr auto Valid(const CacheConfig &config) -> bool {
+    const auto power = [](const u32 value) { return value != 0 and (value & (value - 1)) == 0; };
+    return power(config.size) and power(config.ways) and power(config.lineSize) and config.lineSize >= 4
+      and config.ways <= 32 and config.size >= config.ways * config.lineSize and config.hitLatency >= 1;
+  }
+
+  /// a demand read or write of `address` at cycle `now`, with the line moved
+  /// in, and a dirty one out, as the policies say
+  auto access(const u32 address, const bool write, const u64 now) -> Access {
+    const u32 tag = address >> lineBits;
+    const u32 set = tag & setMask;
+    Line *ways = &lines[(std::size_t)set * config.ways];
+    ++accesses;
+    for (u32 way = 0; way < config.ways; ++way)
+      if (ways[way].valid and ways[way].tag == tag) {
+        Line &line = ways[way];
+        ++hits;
+        touch(set, way);
+        const bool first = line.prefetched;
+        u32 latency = config.hitLatency;
+        if (first) {
+          line.prefetched = false;
+          ++usefulPrefetches;
+          // a prefetch still on its way hides only the part of the miss already over
+          if (line.readyAt > now) {
+            ++latePrefetches;
+            latency = std::max<u32>(latency, static_cast<u32>(line.readyAt - now));
+          }
+        }
+        if (write and config.writeBack)
+          line.dirty = true;
+        else if (write)
+          latency += transfer(address, true, now);
+        return Access{latency, true, first};
+      }
+
+    ++misses;
+    if (write and !config.writeAllocate)
+      return Access{config.hitLatency + transfer(address, true, now), false, false};
+    // the line comes in once a dirty one it evicts has gone out
+    u32 latency = 0;
+    Line &line = ways[fill(set, tag, now, latency)];
+    latency += transfer(address, false, now + latency);
+    line.dirty = write and config.writeBack;
+    line.readyAt = now;
+    // a written-through store that allocates still goes on to memory
+    if (write and !config.writeBack)
+      latency += transfer(address, true, now + latency);
+    return Access{config.hitLatency + latency, false, false};
+  }
+
+  /// start fetching the line of `address` at cycle `now`, unless it is
+  /// cached already; it is usable once memory has moved it
+  auto prefetch(const u32 address, const u64 now) -> void {
+    const u32 tag = address >> lineBits;
+    const u32 set = tag & setMask;
+    const Line *ways = &lines[(std::size_t)set * config.ways];
+    for (u32 way = 0; way < config.ways; ++way)
+      if (ways[way].valid and ways[way].tag == tag)
+        return;
+    ++prefetches;
+    // a dirty victim goes out on the side; no demand access waits for it
+    u32 writeback = 0;
+    Line &line = lines[(std::size_t)set * config.ways + fill(set, tag, now, writeback)];
+    line.prefetched = true;
+    line.readyAt = now + transfer(address, false, now);
+  }
+
+  /// every prefetch arrived, for cycles to count from 0 again
+  auto settle() -> void {
+    for (Line &line : lines)
+      line.readyAt = 0;
+  }
+
+  auto hitRate() const -> f64 {
+    return hits + misses == 0 ? 0 : (f64)hits / (f64)(hits + misses);
+  }
+
+private:
+  /// cycles from `now` until memory has moved the line of `address` in, or out for `write`
+  auto transfer(const u32 address, const bool write, const u64 now) -> u32 {
+    if (dram == nullptr)
+      return config.missLatency;
+    return static_cast<u32>(dram->access(address, write, now) - now);
+  }
+
+  /// the way of `set` that now holds `tag`, clean, its previous line evicted
+  /// and, if dirty, written back from `now` in `writeback` cycles; readyAt
+  /// is for the caller to set
+  auto fill(const u32 set, const u32 tag, const u64 now, u32 &writeback) -> u32 {
+    const u32 way = victim(set);
+    Line &line = lines[(std::size_t)set * config.ways + way];
+    if (line.valid) {
+      ++evictions;
+      uselessPrefetches += line.prefetched;
+    }
+    if (line.valid and line.dirty) {
+      ++writebacks;
+      writeback = transfer(line.tag << lineBits, true, now);
+    }
+    line.dirty = false;
+    line.tag = tag;
+    line.valid = true;
+    line.prefetched = false;
+    touch(set, way);
+    return way;
+  }
+
+  auto touch(const u32 set, const u32 way) -> void {
+    lines[(std::size_t)set * config.ways + way].lastUse = accesses;
+    if (config.replacement != Replacement::PLRU)
+      return;
+    // every node on the way's path points to the other half
+    u32 &bits = plru[set];
+    u32 node = 1;
+    for (u32 level = Log2(config.ways); level-- > 0;) {
+      const u32 right = (way >> level) & 1u;
+      bits = (bits & ~(1u << node)) | ((right ^ 1u) << node);
+      node = node * 2 + right;
+    }
+  }
+
+  auto victim(const u32 set) -> u32 {
+    const Line *ways = &lines[(std::size_t)set * config.ways];
+    for (u32 way = 0; way < config.ways; ++way)
+      if (!ways[way].valid)
+        return way;
+    switch (config.replacement) {
+    case Replacement::LRU: {
+      u32 oldest = 0;
+      for (u32 way = 1; way < config.ways; ++way)
+        if (ways[way].lastUse < ways[oldest].lastUse)
+          oldest = way;
+      return oldest;
+    }
+    case Replacement::PLRU: {
+      u32 node = 1, way = 0;
+      for (u32 level = Log2(config.ways); level-- > 0;) {
+        const u32 right = (plru[set] >> node) & 1u;
+        way = way * 2 + right;
+        node = node * 2 + right;
+      }
+      return way;
+    }
+    case Replacement::Random:
+      seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;
+      return seed & (config.ways - 1);
+    }
+    return 0;
+  }
+};
+
+static_assert(Cache::Valid(L1ICache) and Cache::Valid(L1DCache), "see CacheConfig");
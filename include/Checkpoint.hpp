@@ -0,0 +1,47 @@
+#pragma once
+
+#include "config.hpp"
+
+/// the complete state of an Executor, to be restored bit for bit and run on
+/// as if it had never stopped:
+///
+///   CheckpointHeader
+///   halted, fuse, entry, instret, cycles, fusions
+///   pc, RF, memCycles, stallSignal, killSignal
+///   IF, ID, EX, MEM, WB, memInst   presence byte and the micro-op
+///   predictor counts, then its tables as sparse blobs
+///   fetchCycles, fetchPc, then for icache and dcache: their CacheConfig,
+///   counts and Random seed, and their lines and PLRU bits as sparse blobs
+///   the PrefetchConfig and the prefetcher's table as a sparse blob
+///   the DramConfig, the DRAM counts and its banks as a sparse blob
+///   the store buffer's depth, ring position, counts and entries as a sparse blob
+///   the symbols of the program
+///   memory as a sparse blob of the whole address space
+///
+/// A sparse blob is a u32 count, that many SnapshotExtent (offset and length
+/// of a nonzero run) and their bytes. Caches derived from memory (decode
+/// cache, threaded code, blocks, compiled code) are not saved; they fill
+/// again as the restored program runs. All little-endian; the checksum
+/// covers everything after it, as in a snapshot.
+struct CheckpointHeader {
+  static constexpr char Magic[8] = {'R', 'V', '3', '2', 'C', 'K', 'P', 'T'};
+  static constexpr u32 CurrentVersion = 5;
+
+  char magic[8];
+  u64 checksum;
+  u32 version;
+  u32 codeSize;    // CODE_SIZE of the simulator that wrote it, which sizes the predictor tables
+};
+static_assert(sizeof(CheckpointHeader) == 24);
+
+/// the checkpoint of `executor`, fresh, paused or halted
+auto WriteCheckpoint(const Executor &executor) -> std::string;
+
+/// [begin, end) starts with the checkpoint magic
+auto IsCheckpoint(const char *begin, const char *end) -> bool;
+
+/// restore the checkpoint [begin, end) into `executor`; false, after logging
+/// why and with `executor` untouched, if it is truncated, fails its checksum
+/// or was written with another CODE_SIZE, other caches, another prefetcher,
+/// other DRAM or another store buffer depth
+auto LoadCheckpoint(const char *begin, const char *end, Executor &executor) -> bool;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "config.hpp"
+#include "Memory.hpp"
+#include "RegisterFile.hpp"
+#include "MicroOp.hpp"
+#include "Fusion.hpp"
+
+/// PC-indexed cache of decoded micro-ops, so decoding a previously seen PC is
+/// a table lookup plus a 32-byte copy. Entries are dropped when the guest
+/// stores over them.
+///
+/// fused micro-ops (see Fusion.hpp) live in a second table, allocated on first
+/// use, so the engines that do not fuse never see them.
+struct DecodeCache: MemoryObserver {
+  static constexpr u32 Capacity = CODE_SIZE >> 2;
+  static constexpr u32 Invalid = ~0u;  // pc of an empty entry, never a word address
+
+  std::unique_ptr<MicroOp[]> entries;
+  std::unique_ptr<MicroOp[]> fusedEntries;  // by head pc: the fused pair, or a copy of the plain micro-op
+  u64 hits, misses, invalidations;
+
+  DecodeCache(): entries(std::make_unique<MicroOp[]>(Capacity)), hits(0), misses(0), invalidations(0) {
+    flush();
+  }
+  ~DecodeCache() = default;
+
+  DecodeCache(const DecodeCache &) = delete;
+  auto operator= (const DecodeCache &) -> DecodeCache& = delete;
+
+  /// look up the decoded form of `encoding` at `pc`, decoding and caching it on a miss.
+  /// register operands are read from RF just like a fresh decode.
+  auto decode(const u32 encoding, const u32 pc, const RegisterFile &RF) -> MicroOp {
+    MicroOp op = lookup(encoding, pc);
+    op.read(RF);
+    return op;
+  }
+
+  /// decode() without reading any operands, for engines with registers of their own
+  auto lookup(const u32 encoding, const u32 pc) -> MicroOp {
+    if (pc >= CODE_SIZE) {
+      ++misses;
+      return MicroOp::Decode(encoding, pc);
+    }
+
+    MicroOp &entry = entries[pc >> 2];
+    if (entry.pc == pc and entry.encoding == encoding) {
+      ++hits;
+    } else {
+      ++misses;
+      entry = MicroOp::Decode(encoding, pc);
+    }
+    return entry;
+  }
+
+  /// the cached micro-op for `pc`, decoding it from `mem` on a miss. Used by
+  /// engines that execute micro-ops in place instead of copying them around.
+  auto fetch(const Memory &mem, const u32 pc) -> MicroOp * {
+    if constexpr (!NOASSERT)
+      assert(pc < CODE_SIZE && "pc exceeds CODE_SIZE");
+
+    MicroOp &entry = entries[pc >> 2];
+    if (entry.pc == pc) {
+      ++hits;
+      return &entry;
+    }
+
+    ++misses;
+    entry = MicroOp::Decode(mem.load<u32>(pc), pc);
+    return &entry;
+  }
+
+  /// fetch() with the micro-op at `pc` fused with its successor when the pair
+  /// forms an idiom. A fused micro-op has the pc of its tail, pc + 4.
+  auto fetchFused(const Memory &mem, const u32 pc) -> MicroOp * {
+    if (!fusedEntries) {
+      fusedEntries = std::make_unique<MicroOp[]>(Capacity);
+      for (u32 index = 0; index < Capacity; ++index)
+        fusedEntries[index].pc = Invalid;
+    }
+
+    MicroOp &entry = fusedEntries[pc >> 2];
+    if (entry.pc == pc or entry.pc == pc + 4) {
+      ++hits;
+      return &entry;
+    }
+
+    entry = *fetch(mem, pc);
+    if (pc + 4 < CODE_SIZE)
+      if (const auto fused = Fusion::Fuse(entry, *fetch(mem, pc + 4)))
+        entry = *fused;
+    return &entry;
+  }
+
+  auto invalidate(const u32 address, const u32 size) -> void override {
+    if (size == 0 or address >= CODE_SIZE)
+      return;
+    const u32 last = std::min(address + size - 1, CODE_SIZE - 1) >> 2;
+    for (u32 index = address >> 2; index <= last; ++index)
+      if (entries[index].pc != Invalid) {
+        entries[index].pc = Invalid;
+        ++invalidations;
+      }
+    // a fused micro-op also goes stale when its tail, one word on, is stored over
+    if (fusedEntries)
+      for (u32 index = (address >> 2) - (address >= 4); index <= last; ++index)
+        fusedEntries[index].pc = Invalid;
+  }
+
+  auto flush() -> void {
+    for (u32 index = 0; index < Capacity; ++index)
+      entries[index].pc = Invalid;
+    fusedEntries.reset();
+  }
+
+  auto hitRate() const -> f64 {
+    return hits + misses == 0 ? 0 : (f64)hits / (f64)(hits + misses);
+  }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "config.hpp"
+#include "InstTag.hpp"
+#include "Utility.hpp"
+
+#include <array>
+
+/// instruction decoding as two table loads, both generated at compile time
+/// from RV32I_INSTTAGS: a kind lookup indexed by opcode, funct3 and bit 30
+/// (which tells ADD from SUB and SRL[I] from SRA[I]), followed by a check of
+/// the whole funct7 for the instructions that fix it.
+namespace DecodeTable {
+  using InstTag::ID;
+
+  constexpr u32 AnyFunct7 = 0xff;
+  constexpr u32 Size = 1u << 11;
+
+  constexpr auto Index(const u32 opcode, const u32 funct3, const u32 bit30) -> u32 {
+    return (opcode << 4) | (funct3 << 1) | bit30;
+  }
+
+  constexpr auto IndexOf(const u32 encoding) -> u32 {
+    return Index(GetOpcode(encoding), GetFunct3(encoding), getbits<30>(encoding));
+  }
+
+  /// every (opcode, funct3, bit 30) combination an instruction claims
+  struct Builder {
+    std::array<ID, Size> kinds;
+
+    constexpr Builder(): kinds{} {
+      for (ID &kind : kinds)
+        kind = ID::Unknown;
+    }
+
+    constexpr auto claim(const ID id, const u32 opcode, const u32 funct3First, const u32 funct3Last,
+                         const u32 funct7) -> void {
+      for (u32 funct3 = funct3First; funct3 <= funct3Last; ++funct3)
+        for (u32 bit30 = 0; bit30 < 2; ++bit30) {
+          if (funct7 != AnyFunct7 and bit30 != getbits<5>(funct7))
+            continue;
+          ID &slot = kinds[Index(opcode, funct3, bit30)];
+          if (slot != ID::Unknown)
+            throw "two instructions in RV32I_INSTTAGS share an encoding";
+          slot = id;
+        }
+    }
+  };
+
+  /// the optional FUNCT7 of an I callback
+  constexpr auto Funct7OrAny(const u32 funct7 = AnyFunct7) -> u32 { return funct7; }
+
+  #define CLAIM_R(MNEMONIC, OPCODESTR, OPCODE, FUNCT3, FUNCT7) \
+    builder.claim(ID::MNEMONIC, OPCODE, FUNCT3, FUNCT3, FUNCT7);
+  #define CLAIM_I(MNEMONIC, OPCODESTR, OPCODE, FUNCT3, ...) \
+    builder.claim(ID::MNEMONIC, OPCODE, FUNCT3, FUNCT3, Funct7OrAny(__VA_ARGS__));
+  #define CLAIM_SB(MNEMONIC, OPCODESTR, OPCODE, FUNCT3) \
+    builder.claim(ID::MNEMONIC, OPCODE, FUNCT3, FUNCT3, AnyFunct7);
+  #define CLAIM_UJ(MNEMONIC, OPCODESTR, OPCODE) \
+    builder.claim(ID::MNEMONIC, OPCODE, 0b000, 0b111, AnyFunct7);
+
+  /// kind of every (opcode, funct3, bit 30) combination
+  inline constexpr std::array<ID, Size> Kinds = [] {
+    using namespace InstTag;
+    Builder builder;
+    RV32I_INSTTAGS(INSTTAG_IGNORE, CLAIM_R, CLAIM_I, CLAIM_SB, CLAIM_SB, CLAIM_UJ, CLAIM_UJ)
+    return builder.kinds;
+  }();
+
+  #define GENFUNCT7_R(MNEMONIC, OPCODESTR, OPCODE, FUNCT3, FUNCT7) FUNCT7,
+  #define GENFUNCT7_I(MNEMONIC, OPCODESTR, OPCODE, FUNCT3, ...) Funct7OrAny(__VA_ARGS__),
+  #define GENFUNCT7_ANY(...) AnyFunct7,
+  /// funct7 every instruction requires, AnyFunct7 where those bits are an immediate
+  inline constexpr u8 Funct7s[InstTag::NumIDs] = {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENFUNCT7_R, GENFUNCT7_I, GENFUNCT7_ANY, GENFUNCT7_ANY, GENFUNCT7_ANY, GENFUNCT7_ANY)
+    AnyFunct7,
+  };
+
+  #undef GENFUNCT7_R
+  #undef GENFUNCT7_I
+  #undef GENFUNCT7_ANY
+  #undef CLAIM_R
+  #undef CLAIM_I
+  #undef CLAIM_SB
+  #undef CLAIM_UJ
+}
+
+/// kind of the instruction `encoding`, ID::Unknown if it is not in RV32I_INSTTAGS
+constexpr auto DecodeKind(const u32 encoding) -> InstTag::ID {
+  const InstTag::ID kind = DecodeTable::Kinds[DecodeTable::IndexOf(encoding)];
+  const u32 funct7 = DecodeTable::Funct7s[static_cast<u32>(kind)];
+  if (funct7 != DecodeTable::AnyFunct7 and GetFunct7(encoding) != funct7)
+    return InstTag::ID::Unknown;
+  return kind;
+}
+
+static_assert(DecodeKind(HaltEncoding) == InstTag::ID::ADDI);
+static_assert(DecodeKind(0x40b50533u) == InstTag::ID::SUB);    // sub a0, a0, a1
+static_assert(DecodeKind(0x02b50533u) == InstTag::ID::Unknown); // mul a0, a0, a1
+static_assert(DecodeKind(0x4015d513u) == InstTag::ID::SRAI);   // srai a0, a1, 1
+static_assert(DecodeKind(0x00008067u) == InstTag::ID::JALR);   // ret
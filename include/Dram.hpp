@@ -0,0 +1,88 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <bit>
+#include <vector>
+
+/// main memory behind the caches, as banks of rows (see DramConfig). It is
+/// event-driven: a bank remembers its open row and the cycle it is free
+/// again, and is only looked at when a request comes, so cycles without
+/// one cost nothing. Like the caches it times transfers and holds no data.
+struct Dram {
+  struct Bank {
+    u64 readyAt;  // cycle the bank takes its next command, once the last one and any precharge are over
+    u32 row;      // the open row, if open
+    u8 open;
+    u8 pad[3];
+  };
+  static_assert(sizeof(Bank) == 16);
+
+  DramConfig config;
+  u32 rowBits, bankBits;
+  std::vector<Bank> banks;
+  u64 reads, writes;
+  u64 rowHits;      // the row was open
+  u64 rowMisses;    // the bank was precharged, so the row was activated first
+  u64 rowConflicts; // another row was open, so the bank precharged and activated first
+  u64 bankWaits, bankWaitCycles; // requests that found their bank busy, and the cycles they waited
+
+  explicit Dram(const DramConfig &configured): config(configured),
+    rowBits(static_cast<u32>(std::countr_zero(configured.rowSize))),
+    bankBits(static_cast<u32>(std::countr_zero(configured.banks))), banks(configured.banks), reads(0), writes(0),
+    rowHits(0), rowMisses(0), rowConflicts(0), bankWaits(0), bankWaitCycles(0) {}
+
+  /// `config` describes memory this model can time
+  static constexpr auto Valid(const DramConfig &config) -> bool {
+    const auto power = [](const u32 value) { return value != 0 and (value & (value - 1)) == 0; };
+    return power(config.banks) and power(config.rowSize) and config.rowSize >= 64 and config.tCAS >= 1;
+  }
+
+  /// a read or write of the line at `address`, requested at cycle `now`;
+  /// the cycle its data has moved. Consecutive rows lie in consecutive banks.
+  auto access(const u32 address, const bool write, const u64 now) -> u64 {
+    const u32 rowIndex = address >> rowBits;
+    Bank &bank = banks[rowIndex & (config.banks - 1)];
+    const u32 row = rowIndex >> bankBits;
+    ++(write ? writes : reads);
+    const u64 start = std::max(now, bank.readyAt);
+    if (start > now) {
+      ++bankWaits;
+      bankWaitCycles += start - now;
+    }
+
+    u64 done;
+    if (bank.open and bank.row == row) {
+      ++rowHits;
+      done = start + config.tCAS;
+    } else if (bank.open) {
+      ++rowConflicts;
+      done = start + config.tRP + config.tRCD + config.tCAS;
+    } else {
+      ++rowMisses;
+      done = start + config.tRCD + config.tCAS;
+    }
+    if (config.policy == RowPolicy::Open) {
+      bank.open = true;
+      bank.row = row;
+      bank.readyAt = done;
+    } else {
+      // the precharge follows the access, off the path of this request
+      bank.open = false;
+      bank.readyAt = done + config.tRP;
+    }
+    return done;
+  }
+
+  /// every bank done with what it was doing, for cycles to count from 0 again
+  auto settle() -> void {
+    for (Bank &bank : banks)
+      bank.readyAt = 0;
+  }
+
+  auto accesses() const -> u64 {
+    return reads + writes;
+  }
+};
+
+static_assert(Dram::Valid(MainMemory), "see DramConfig");
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <vector>
+
+struct Memory;
+
+/// a named address from an ELF symbol table
+struct Symbol {
+  std::string name;
+  u32 value;  // address
+  u32 size;   // bytes, 0 if unknown
+  bool function;
+};
+
+/// what a loaded image says about the program besides memory contents: where
+/// it starts and its symbols, by address. Hex text images start at pc 0 and
+/// have no symbols.
+struct ProgramInfo {
+  u32 entry;
+  std::vector<Symbol> symbols;
+
+  /// the symbol whose extent holds `address`, or the closest one below it
+  /// when sizes are unknown; nullptr if there is none
+  auto symbolAt(const u32 address) const -> const Symbol *;
+};
+
+/// [begin, end) starts with the ELF magic
+auto IsElf(const char *begin, const char *end) -> bool;
+
+/// copy the PT_LOAD segments of the ELF32 little-endian RISC-V executable
+/// [begin, end) into `mem`, which is all zero, and read its entry point and
+/// symbol table. nullopt, after logging why, if the file is not such an
+/// executable or its entry point is not below CODE_SIZE.
+auto LoadElf(const char *begin, const char *end, Memory &mem) -> std::optional<ProgramInfo>;
@@ -5,27 +5,136 @@
 #include "Memory.hpp"
 #include "Signals.hpp"
 #include "Predictor.hpp"
-#include "Instruction.hpp"
+#include "Cache.hpp"
+#include "Prefetcher.hpp"
+#include "StoreBuffer.hpp"
+#include "MicroOp.hpp"
+#include "DecodeCache.hpp"
+#include "ThreadedCode.hpp"
+#include "BlockCache.hpp"
+#include "Jit.hpp"
+#include "Checkpoint.hpp"
+
+/// how the program is simulated
+enum struct Engine {
+  Pipeline,   // cycle-level 5-stage pipeline with forwarding, stalls and prediction
+  Functional, // one instruction per step, architectural state only
+  Threaded,   // functional, dispatched through pre-translated threaded code
+  Block,      // functional, running chained translated basic blocks
+  Jit,        // Block, with hot blocks compiled to native code
+};
 
 struct Executor {
-  InstPtr IF, ID, EX, MEM, WB;
+  using Latch = std::optional<MicroOp>;  // empty for a bubble
+  Latch IF, ID, EX, MEM, WB;
+  Latch memInst;  // instruction occupying the memory stage while it waits
+  u32 memCycles;  // cycles left of memInst's access (see dcache)
+  u32 fetchCycles; // cycles left of the fetch at fetchPc, while an instruction cache miss holds IF empty
+  u32 fetchPc;
   Register pc;
   RegisterFile RF;
   StallSignal stallSignal;
   KillSignal killSignal;
   Predictor predictor;
+  Cache icache, dcache; // time the pipeline's fetches and its loads and stores, with UseCaches
+  Prefetcher prefetcher; // fetches ahead into dcache
+  Dram dram;      // times what misses the caches, or every load and store without UseCaches, with UseDram
+  StoreBuffer storeBuffer; // stores retired from MEM, on their way to dcache
   Memory mem;
+  DecodeCache decodeCache;
+  ThreadedCode threadedCode;
+  BlockCache blockCache;
+  JitCodeBuffer jitCode;
+  u64 jitCompiled; // blocks compiled by the last run
+  u64 instret;    // instructions retired since run()
+  u64 cycles;     // clock cycles the pipeline simulated since run()
+  u64 pauseAt;    // the pipeline stops before this cycle, the functional engine once this many
+                  // instructions retired; the state is then left for resume() or a checkpoint
+  u64 pauseRetired; // the pipeline also stops before the cycle after this many instructions retired
+  bool halted;    // the program ran into HaltEncoding
+  bool restored;  // the state came from a checkpoint, which the next run() resumes
+  bool fuse;      // fuse instruction pairs (see Fusion.hpp) in the pipeline and functional engines
+  u64 fusions[NumFusedPairs]; // fused pairs retired by the last run, by pair
+  ProgramInfo program;  // entry point and symbols of the loaded image
+
+  Executor(): memCycles(0), fetchCycles(0), fetchPc(0), icache(L1ICache), dcache(L1DCache), prefetcher(L1DPrefetch), dram(MainMemory), storeBuffer(StoreBufferDepth), mem{}, decodeCache{}, threadedCode{}, blockCache{}, jitCode{}, jitCompiled(0), instret(0),
+    cycles(0), pauseAt(~0ull), pauseRetired(~0ull), halted(false), restored(false), fuse(false), fusions{}, program{} { attachCaches(); }
+  Executor(std::istream &input): Executor() { initMem(input); }
 
-  Executor(): mem{} {}
-  Executor(std::istream &input): mem(input) {}
+  auto attachCaches() -> void {
+    mem.attach(&decodeCache);
+    mem.attach(&threadedCode);
+    mem.attach(&blockCache);
+    if constexpr (UseDram)
+      icache.dram = dcache.dram = &dram;
+  }
 
-  auto initMem(std::istream &input) { mem.readfrom(input); }
+  /// load an ELF executable, a snapshot or a hex text image, or restore a
+  /// checkpoint (see Checkpoint.hpp); false if it cannot be run
+  auto initMem(const ImageText &text) -> bool {
+    if (IsCheckpoint(text.begin, text.end))
+      return restored = LoadCheckpoint(text.begin, text.end, *this);
+    restored = false;
+    std::optional<ProgramInfo> loaded = mem.readimage(text);
+    program = loaded ? std::move(*loaded) : ProgramInfo{0, {}};
+    return loaded.has_value();
+  }
+  auto initMem(std::istream &input) -> bool { return initMem(ImageText::fromStream(input)); }
 
   auto InstFetch() -> void;
+  /// latch the word at `at` into IF and point pc past it, once the
+  /// instruction cache has it; until then IF stays empty and pc at `at`
+  auto fetch(const u32 at) -> void;
   auto InstDecode() -> void;
   auto InstExecute() -> void;
   auto InstMemAccess() -> void;
   auto InstWriteBack() -> void;
+  /// cycles the load or store at `instPc` to `address` takes from cycle
+  /// `at`, through dcache, DRAM or FlatMemoryLatency, whichever are in use
+  auto memoryLatency(const u32 instPc, const u32 address, const bool write, const u64 at) -> u32;
+  /// memoryLatency, as the store buffer reaches memory through it
+  auto dataPort() {
+    return [this](const u32 instPc, const u32 address, const bool write, const u64 at) {
+      return memoryLatency(instPc, address, write, at);
+    };
+  }
+
+  auto runPipeline() -> u32;
+  auto runFunctional() -> u32;
+  auto runThreaded() -> u32;
+  auto runBlocks() -> u32;
+  auto runJit() -> u32;
+  auto translateBlock(const u32 start) -> Block *;
+  auto dumpFunctionalStats() -> void;
+  auto dumpCacheStats() -> void;
+  auto dumpDramStats() -> void;
+  auto dumpStoreBufferStats() -> void;
+  auto dumpFusionStats() -> void;
+
+  /// instructions are in the pipeline latches, so only the pipeline can go on
+  auto inFlight() const -> bool {
+    return IF or ID or EX or MEM or WB or memInst or memCycles != 0 or fetchCycles != 0;
+  }
+
+  /// `engine` can run what was loaded; false, after logging why, for a
+  /// checkpoint with instructions inFlight() and any engine but the pipeline
+  auto runnableOn(const Engine engine) const -> bool {
+    if (!restored or engine == Engine::Pipeline or !inFlight())
+      return true;
+    LOG("a checkpoint taken inside the pipeline goes on with --engine=pipeline only\n");
+    return false;
+  }
 
-  auto exec(std::istream &input) -> u32;
+  /// run the loaded program from its entry point, or from the checkpoint it
+  /// was restored from, and return its exit value; 0 if a guest fault
+  /// stopped it, which is then logged and left in mem.fault
+  auto run(const Engine engine = Engine::Pipeline) -> u32;
+  /// go on from where the last run paused (see pauseAt); returns like run().
+  /// Only the pipeline goes on from a state with instructions inFlight().
+  auto resume(const Engine engine = Engine::Pipeline) -> u32;
+  /// drop the instructions in flight in a paused pipeline and point pc at the
+  /// oldest of them, which no engine has retired; any engine then goes on
+  /// from there as if the pipeline had never fetched them
+  auto squash() -> void;
+  auto exec(std::istream &input, const Engine engine = Engine::Pipeline) -> u32;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <vector>
+
+/// a word stored into guest memory before a served run starts
+struct InputPatch {
+  u32 address;
+  u32 value;
+};
+
+/// outcome of one served run
+struct ServedRun {
+  bool completed;   // false if the run died without reporting, e.g. on a host crash
+  bool faulted;     // a guest fault stopped it; ret is then 0
+  u32 ret;          // exit value, as ./code prints it
+  u64 instret;      // instructions retired, counting any warm-up
+  u64 cycles;       // clock cycles, with the pipeline, counting any warm-up
+  f64 ms;           // wall time from fork to the end of the run
+};
+
+/// runs one program many times from one warmed Executor: the image is
+/// loaded, and optionally run up to a pause point, once; every run then
+/// forks the process, so the clone shares memory, predictor tables and
+/// every cache copy-on-write with the server. The clone stores its patches,
+/// goes on from the warm state and reports back through a pipe. Nothing the
+/// clone does reaches the server, so runs are independent of each other.
+struct ForkServer {
+  Executor &warm;
+  Engine engine;
+
+  /// warm `executor`, which holds a loaded program, by running it until
+  /// its pauseAt if that is set; false if it halted or faulted doing so
+  static auto Warm(Executor &executor, const Engine engine) -> bool;
+
+  auto run(const std::vector<InputPatch> &patches) const -> ServedRun;
+};
+
+/// "address=value ..." with numbers as strtoul reads them (0x for hex);
+/// nullopt, after logging why, on anything else
+auto ParsePatches(const std::string &line) -> std::optional<std::vector<InputPatch>>;
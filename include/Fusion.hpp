@@ -0,0 +1,39 @@
+#pragma once
+
+#include "config.hpp"
+#include "MicroOp.hpp"
+#include "Memory.hpp"
+#include "RegisterFile.hpp"
+
+/// macro-op fusion of the RV32I idioms compilers emit in pairs:
+///
+///   lui   rd, hi  ; addi  rd, rd, lo         constant materialization
+///   auipc rd, hi  ; jalr  rd', lo(rd)        far call / tail call
+///   lui   rd, hi  ; lw/sw ..., lo(rd)        access to a global
+///
+/// the fused micro-op is the tail at pc + 4 with its base register folded
+/// away: rs1 is x0 and imm is the full constant, address or (for auipc +
+/// jalr, which becomes a JAL) the pc-relative target. The head's own write
+/// survives as headRd when the tail does not overwrite it.
+namespace Fusion {
+  inline constexpr char const *Names[NumFusedPairs] = { "none", "lui+addi", "auipc+jalr", "lui+load", "lui+store" };
+
+  /// the fused micro-op of `head` followed by `tail`, if the two form an idiom
+  auto Fuse(const MicroOp &head, const MicroOp &tail) -> std::optional<MicroOp>;
+}
+
+/// execute a fused micro-op to completion and return the next pc
+inline auto RetireFused(MicroOp &op, RegisterFile &RF, Memory &mem) -> u32 {
+  RF.writeThrough(op.headRd, op.headValue());
+  op.read(RF);
+  Execute(op);
+  if (InstTag::IsLoad(op.kind)) {
+    MemAccess(op, mem);
+    RF.writeThrough(op.rd, op.rdv);
+  } else if (InstTag::IsStore(op.kind)) {
+    MemAccess(op, mem);
+  } else {
+    RF.writeThrough(op.rd, op.rdv);
+  }
+  return op.kind == InstTag::ID::JAL ? op.target() : op.pc + 4;
+}
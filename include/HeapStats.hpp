@@ -0,0 +1,7 @@
+#pragma once
+
+#include "config.hpp"
+
+/// number of heap allocations made through the global operator new,
+/// used to check that the pipeline does not allocate in steady state
+u64 HeapAllocations();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "config.hpp"
+
+struct Memory;
+
+/// the contents of an image file, .data text or ELF, as one contiguous
+/// buffer: the file itself, mapped read-only, when it is a regular file, and
+/// a copy otherwise (pipes, terminals, std::istream). Loading never copies it
+/// again.
+struct ImageText {
+  const char *begin, *end;
+
+  ImageText(): begin(nullptr), end(nullptr), mapping(nullptr), mappedSize(0), buffer{} {}
+  ~ImageText();
+
+  ImageText(ImageText &&other) noexcept;
+  auto operator= (ImageText &&other) noexcept -> ImageText&;
+  ImageText(const ImageText &) = delete;
+  auto operator= (const ImageText &) -> ImageText& = delete;
+
+  /// the image in `path`; nullopt if it cannot be opened
+  static auto open(const char *path) -> std::optional<ImageText>;
+  /// the image read from `fd` (e.g. 0 for stdin) up to end of file
+  static auto fromFd(const i32 fd) -> ImageText;
+  /// the image read from `input` up to end of file
+  static auto fromStream(std::istream &input) -> ImageText;
+
+private:
+  void *mapping;
+  std::size_t mappedSize;
+  std::string buffer;
+
+  auto release() -> void;
+};
+
+/// parse the .data text [begin, end) into `mem`, which is all zero.
+/// `@address` lines move the write position and every other
+/// whitespace-separated token is a hex byte. Runs of two-digit tokens are
+/// converted 16 at a time with SSSE3 where the host has it.
+auto ParseImage(const char *begin, const char *end, Memory &mem) -> void;
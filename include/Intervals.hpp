@@ -0,0 +1,37 @@
+#pragma once
+
+#include "config.hpp"
+#include "Executor.hpp"
+
+/// how RunIntervals splits a run
+struct IntervalOptions {
+  u64 length = IntervalLength;  // instructions per interval
+  u64 warmup = IntervalWarmup;  // instructions each interval after the first runs through the pipeline unmeasured
+  u32 jobs = 1;                 // worker threads
+};
+
+/// a pipeline run stitched together from its intervals
+struct IntervalRun {
+  bool faulted;       // a guest fault stopped it; ret is then 0
+  u32 ret;            // exit value, as ./code prints it
+  u64 instret;        // instructions retired
+  u64 cycles;         // clock cycles, summed over the intervals
+  u64 hits;           // predictor hits and predictions, summed over the intervals
+  u64 predictions;
+  u64 intervals;      // measured; one the program ends in the warm-up of is not
+  u64 checkpointBytes; // size of the checkpoints, summed
+
+  auto accuracy() const -> f64 {
+    return predictions == 0 ? 0 : (f64)hits / (f64)predictions;
+  }
+};
+
+/// run the program loaded into `executor` (or the checkpoint restored into
+/// it) to the end with the functional engine, checkpointing it every
+/// `length` instructions, while `jobs` worker threads take the checkpoints
+/// as they come and time each interval through the pipeline. A worker
+/// starts `warmup` instructions before its interval, to fill the pipeline
+/// and prime the predictor, and counts cycles from the cycle the interval's
+/// first instruction would retire in to that of the next interval's. The
+/// first interval starts cold, as a serial run does.
+auto RunIntervals(Executor &executor, const IntervalOptions &options) -> IntervalRun;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "config.hpp"
+#include "BlockCache.hpp"
+
+#include <vector>
+
+#if defined(__x86_64__) && defined(__unix__)
+  #define JIT_X86_64 1
+#else
+  #define JIT_X86_64 0  // no native backend: the JIT engine only interprets
+#endif
+
+/// why compiled code returned to the dispatcher
+enum struct JitExit: u32 {
+  Normal, // returned the next pc
+  Store,  // a store hit translated code; returned the next pc
+};
+
+/// state shared between the dispatcher and compiled blocks. Compiled code
+/// addresses every field relative to the context pointer it is called with.
+struct JitContext {
+  u32 x[32];          // guest registers, x[0] stays 0
+  u8 *memory;         // Memory::base
+  const u8 *code;     // BlockCache::translated, one byte per word
+  u64 instret;
+  JitExit exit;
+  u32 address;        // guest address of the store that hit translated code (JitExit::Store)
+  u32 storeSize;
+};
+
+/// executable memory for compiled blocks, bump allocated and released as a whole
+struct JitCodeBuffer {
+  static constexpr u64 Capacity = 16u << 20;
+
+  u8 *base;
+  u64 used;
+
+  JitCodeBuffer();
+  ~JitCodeBuffer();
+
+  JitCodeBuffer(const JitCodeBuffer &) = delete;
+  auto operator= (const JitCodeBuffer &) -> JitCodeBuffer& = delete;
+
+  auto available() const -> bool { return base != nullptr; }
+  auto reset() -> void { used = 0; }
+
+  /// copy `code` into executable memory, nullptr if it does not fit
+  auto install(const std::vector<u8> &code) -> Block::NativeCode;
+};
+
+/// translate a block to x86-64, nullptr if it contains anything unsupported
+auto JitCompile(const Block &block, JitCodeBuffer &buffer) -> Block::NativeCode;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "config.hpp"
+#include "Memory.hpp"
+#include "MicroOp.hpp"
+#include "DecodeCache.hpp"
+
+/// a group of LockstepLanes independent harts run in lockstep: every step
+/// executes one instruction for all lanes that are at the same pc and see the
+/// same word there, on registers stored register-major (struct of arrays), so
+/// that the semantics of MicroOp.hpp, applied lane by lane, compile to one
+/// vector operation per register. Lanes that diverge wait, masked off, until
+/// the lanes at lower pcs catch up with them (min-pc reconvergence).
+///
+/// each lane has its own Memory, so the lanes may run different inputs and
+/// even different programs, at the cost of lane utilization.
+struct LockstepGroup {
+  static constexpr u32 Lanes = LockstepLanes;
+  static_assert(Lanes <= 32, "lane masks are u32");
+
+  alignas(64) u32 x[32][Lanes];  // x[reg][lane]
+  alignas(64) u32 pc[Lanes];
+  u64 instret[Lanes];            // instructions retired, by lane
+  u32 ret[Lanes];                // exit value of every halted lane
+  u32 entry[Lanes];              // pc each lane starts at
+  u32 loaded;                    // lanes holding a program
+  u32 running;                   // lanes neither halted nor unloaded
+  u32 faulted;                   // lanes a guest fault stopped, with ret 0
+  u32 sameImage;                 // lanes loaded with the image of the first loaded lane
+  std::unique_ptr<u32[]> written; // by word, one past the end included: lanes that stored to it
+  u64 steps;                     // group steps taken by the last run
+  Memory mem[Lanes];
+  DecodeCache decodeCache;       // by pc and encoding, shared by every lane
+
+  LockstepGroup(): x{}, pc{}, instret{}, ret{}, entry{}, loaded(0), running(0), faulted(0), sameImage(0),
+    written(std::make_unique<u32[]>((CODE_SIZE >> 2) + 1)), steps(0), mem{}, decodeCache{} {}
+
+  LockstepGroup(const LockstepGroup &) = delete;
+  auto operator= (const LockstepGroup &) -> LockstepGroup& = delete;
+
+  /// load a program image, ELF or hex text, into `lane`; false if it cannot be run
+  auto load(const u32 lane, const ImageText &text) -> bool {
+    const std::optional<ProgramInfo> program = mem[lane].readimage(text);
+    if (!program)
+      return false;
+    entry[lane] = program->entry;
+    loaded |= 1u << lane;
+    return true;
+  }
+
+  /// run every loaded lane from its entry point until it halts or faults
+  auto run() -> void;
+
+  /// step the running lanes until none is left, from their pcs
+  auto advance() -> void;
+
+  /// lane-instructions retired per group step, out of Lanes
+  auto utilization() const -> f64 {
+    u64 total = 0;
+    for (u32 lane = 0; lane < Lanes; ++lane)
+      total += instret[lane];
+    return steps == 0 ? 0 : (f64)total / (f64)steps;
+  }
+};
@@ -1,48 +1,177 @@
 #pragma once
 
 #include "config.hpp"
+#include "Image.hpp"
+#include "Elf.hpp"
+#include "Snapshot.hpp"
+#include "Checkpoint.hpp"
 
+#include <csetjmp>
+#include <vector>
+
+/// notified whenever guest memory is written, so that anything derived from
+/// memory contents (e.g. predecoded instructions) can drop stale entries
+struct MemoryObserver {
+  virtual ~MemoryObserver() = default;
+  virtual auto invalidate(const u32 address, const u32 size) -> void = 0;
+};
+
+/// a guest access that guest memory cannot serve
+struct GuestFault {
+  u64 address;        // of the first byte that could not be accessed, past 0xffffffff if the access ran off the top
+  bool write;
+  const char *reason;
+};
+
+/// where a guest fault raised on this thread resumes; see TrapGuestFaults
+struct GuestFaultTrap {
+  sigjmp_buf resume;
+  GuestFaultTrap *outer;
+};
+extern thread_local GuestFaultTrap *CurrentGuestFaultTrap;
+
+/// run `body`; false if a guest fault stopped it, which is then recorded in
+/// the Memory it hit. Outside any trap a guest fault ends the process with a
+/// report. Nothing `body` allocates is freed when it is stopped, so it
+/// should only run the simulation proper.
+template <typename Body>
+[[gnu::noinline]] auto TrapGuestFaults(Body &&body) -> bool {
+  GuestFaultTrap trap;
+  trap.outer = CurrentGuestFaultTrap;
+  CurrentGuestFaultTrap = &trap;
+  if (sigsetjmp(trap.resume, 1) != 0) {
+    CurrentGuestFaultTrap = trap.outer;
+    return false;
+  }
+  body();
+  CurrentGuestFaultTrap = trap.outer;
+  return true;
+}
+
+/// log `fault` the way an untrapped one is reported
+auto LogGuestFault(const GuestFault &fault) -> void;
+
+/// guest memory: the whole 32-bit address space, reserved up front as one
+/// inaccessible host mapping followed by a guard page, so that guest address
+/// `a` is always at `base + a` and loads and stores need no check at all.
+/// The first access to a page faults into a SIGSEGV handler that commits it:
+/// a read maps it read-only, backed by the host's shared zero page, and a
+/// write maps it writable, which is when it starts to take memory. Accesses
+/// that run into the guard page, or writes past MemoryLimit, are guest faults.
 struct Memory {
-  u8 mem[MEMORY_SIZE + 10];
+  static constexpr u32 PageBits = 12;
+  static constexpr u32 PageSize = 1u << PageBits;
+  static constexpr u32 PageMask = PageSize - 1;
+  static constexpr u32 PageCount = 1u << (32 - PageBits);
+  static constexpr u64 Reserved = (1ull << 32) + PageSize;  // the address space and the guard page past its top
+  static constexpr u32 LimitPages = static_cast<u32>(std::min<u64>(MemoryLimit >> PageBits, PageCount));
+
+  enum PageState: u8 { Unmapped, Readable, Written };
+
+  u8 *base;                   // guest address 0
+  u8 *state;                  // PageState by page number
+  std::vector<u32> touched;   // numbers of the written pages, in order of first write; never reallocated
+  std::vector<MemoryObserver *> observers;
+  std::optional<GuestFault> fault;  // what stopped the last trapped run, if a guest fault did
+
+  Memory();
+  Memory(std::istream &input): Memory() { readfrom(input); }
+  ~Memory();
 
-  Memory(): mem{0} {}
-  Memory(std::istream &input) { readfrom(input); }
+  Memory(const Memory &) = delete;
+  auto operator= (const Memory &) -> Memory& = delete;
+
+  auto attach(MemoryObserver *observer) -> void {
+    observers.push_back(observer);
+  }
+
+  auto notify(const u32 address, const u32 size) -> void {
+    for (MemoryObserver *observer : observers)
+      observer->invalidate(address, size);
+  }
+
+  /// the page holding `address`, committed writable if it was not yet
+  auto page(const u32 address) -> u8 * {
+    const u32 number = address >> PageBits;
+    if (state[number] != Written)
+      commit(number, true);
+    return base + ((u64)number << PageBits);
+  }
+
+  /// the page holding `address`, nullptr if it was never written
+  auto find(const u32 address) const -> const u8 * {
+    const u32 number = address >> PageBits;
+    return state[number] == Written ? base + ((u64)number << PageBits) : nullptr;
+  }
+
+  /// map `count` pages from `number` for reading, or for writing; a guest
+  /// fault, raised through the current trap, if the write would exceed
+  /// LimitPages. Called by the fault handler, page() and write().
+  auto commit(const u32 number, const bool write, const u32 count = 1) -> void;
+
+  /// copy `size` bytes between guest memory at `address` and the host; they
+  /// may span pages, and wrap around the top of the address space. Neither
+  /// faults: read() leaves unwritten pages alone and yields zeros for them.
+  auto read(u32 address, void *data, u32 size) const -> void;
+  auto write(u32 address, const void *data, u32 size) -> void;
+
+  /// drop every written page, leaving memory all zero
+  auto clear() -> void;
+
+  /// both memories hold the same bytes
+  auto equals(const Memory &other) const -> bool;
+
+  /// bytes of guest memory written
+  auto footprint() const -> u64 { return (u64)touched.size() * PageSize; }
 
   auto readfrom(std::istream &input) -> void {
+    readfrom(ImageText::fromStream(input));
+  }
+
+  auto readfrom(const ImageText &text) -> void {
     if constexpr (DumpOptions::TrackMemOp)
       LOG("---------- loading memory ----------\n");
-    std::memset(mem, 0, sizeof mem);
-    std::string buf;
-    u8 *pos = mem; u32 value;
-    while (std::getline(input, buf)) {
-      if (buf[0] == '@') {
-        pos = mem + std::stoi(buf.substr(1), nullptr, 16);
-      } else {
-        std::stringstream ss(buf); ss << std::hex;
-        while (ss >> value) {
-          *pos++ = static_cast<u8>(value);
-        }
-      }
-    }
+    clear();
+    ParseImage(text.begin, text.end, *this);
+    notify(0, CODE_SIZE);
     if constexpr (DumpOptions::TrackMemOp)
       LOG("---------- memory loaded ----------\n");
   }
 
+  /// load an ELF executable, a snapshot or a hex text image, whichever
+  /// `text` holds; nullopt if it is a binary the simulator cannot run, or a
+  /// checkpoint, which only a whole Executor restores
+  auto readimage(const ImageText &text) -> std::optional<ProgramInfo> {
+    if (IsCheckpoint(text.begin, text.end)) {
+      LOG("a checkpoint restores a whole Executor, not memory alone\n");
+      return std::nullopt;
+    }
+    const bool elf = IsElf(text.begin, text.end);
+    if (!elf and !IsSnapshot(text.begin, text.end)) {
+      readfrom(text);
+      return ProgramInfo{0, {}};
+    }
+    clear();
+    std::optional<ProgramInfo> program = elf ? LoadElf(text.begin, text.end, *this)
+                                             : LoadSnapshot(text.begin, text.end, *this);
+    notify(0, CODE_SIZE);
+    return program;
+  }
+
   template <typename T>
   auto load(const u32 address) const -> T {
-    if constexpr (!NOASSERT)
-      assert(address < MEMORY_SIZE && "load address exceeds MEMORY_SIZE");
+    T value;
+    std::memcpy(&value, base + address, sizeof(T));
     if constexpr (DumpOptions::TrackMemOp)
-      LOG("load from memory: addr = %08x, value = %08x\n", address, *((T*)(mem + address)));
-    return *((T*)(mem + address));
+      LOG("load from memory: addr = %08x, value = %08x\n", address, value);
+    return value;
   }
 
   template <typename T>
   auto store(const u32 address, const T &value) -> void {
-    if constexpr (!NOASSERT)
-      assert(address < MEMORY_SIZE && "store address exceeds MEMORY_SIZE");
     if constexpr (DumpOptions::TrackMemOp)
       LOG("store to memory:   addr = %08x, value = %08x\n", address, value);
-    *((T*)(mem + address)) = value;
+    std::memcpy(base + address, &value, sizeof(T));
+    notify(address, sizeof(T));
   }
 };
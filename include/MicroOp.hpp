@@ -0,0 +1,245 @@
+#pragma once
+
+#include "config.hpp"
+#include "InstTag.hpp"
+#include "Memory.hpp"
+#include "RegisterFile.hpp"
+#include "Utility.hpp"
+#include "DecodeTable.hpp"
+
+/// instruction formats, as named in the RV32I spec
+enum struct InstFormat: u8 { R, I, S, B, U, J, None };
+
+namespace InstTag {
+  #define GENOPCODE_(MNEMONIC, OPCODESTR, OPCODE, ...) OPCODE,
+  /// major opcode of every instruction, indexed by ID
+  inline constexpr u32 Opcodes[NumIDs] = {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENOPCODE_, GENOPCODE_, GENOPCODE_, GENOPCODE_, GENOPCODE_, GENOPCODE_)
+    Unknown::opcode,
+  };
+  #undef GENOPCODE_
+
+  #define GENSTR(MNEMONIC, OPCODESTR, ...) OPCODESTR,
+  /// assembler mnemonic of every instruction, indexed by ID
+  inline constexpr char const *Opcodestrs[NumIDs] = {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENSTR, GENSTR, GENSTR, GENSTR, GENSTR, GENSTR)
+    Unknown::opcodestr,
+  };
+  #undef GENSTR
+
+  #define GENFMT_R(...) InstFormat::R,
+  #define GENFMT_I(...) InstFormat::I,
+  #define GENFMT_S(...) InstFormat::S,
+  #define GENFMT_B(...) InstFormat::B,
+  #define GENFMT_U(...) InstFormat::U,
+  #define GENFMT_J(...) InstFormat::J,
+  /// encoding format of every instruction, indexed by ID
+  inline constexpr InstFormat Formats[NumIDs] = {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENFMT_R, GENFMT_I, GENFMT_S, GENFMT_B, GENFMT_U, GENFMT_J)
+    InstFormat::None,
+  };
+  #undef GENFMT_R
+  #undef GENFMT_I
+  #undef GENFMT_S
+  #undef GENFMT_B
+  #undef GENFMT_U
+  #undef GENFMT_J
+
+  constexpr auto OpcodeOf(const ID id) -> u32 { return Opcodes[static_cast<u32>(id)]; }
+  constexpr auto FormatOf(const ID id) -> InstFormat { return Formats[static_cast<u32>(id)]; }
+
+  constexpr auto IsLoad(const ID id) -> bool { return OpcodeOf(id) == OPC_LOAD; }
+  constexpr auto IsStore(const ID id) -> bool { return OpcodeOf(id) == OPC_STORE; }
+  constexpr auto IsBranch(const ID id) -> bool { return OpcodeOf(id) == OPC_BRANCH; }
+  /// ends a basic block: conditional branches and both jumps
+  constexpr auto IsControl(const ID id) -> bool { return IsBranch(id) or id == ID::JAL or id == ID::JALR; }
+  /// R, I, U and J formats write rd in the write-back stage
+  constexpr auto WritesRd(const ID id) -> bool {
+    const InstFormat format = FormatOf(id);
+    return format != InstFormat::S and format != InstFormat::B and format != InstFormat::None;
+  }
+}
+
+/// the instruction pair a fused micro-op stands for (see Fusion.hpp)
+enum struct FusedPair: u8 { None, LuiAddi, AuipcJalr, LuiLoad, LuiStore };
+constexpr u32 NumFusedPairs = 5;
+
+/// a decoded instruction. It is flat and trivially copyable, so the pipeline
+/// latches, the decode cache and every functional engine hold micro-ops by
+/// value and dispatch on `kind` instead of through a vtable.
+///
+/// operands not used by the format are 0 (rs2 of I, rs1 and rs2 of U / J, rd
+/// of S / B), so that forwarding never matches them.
+struct MicroOp {
+  u32 encoding;
+  u32 pc;
+  u32 imm;              // sign-extended immediate; the shift amount of SLLI / SRLI / SRAI
+  u32 rs1v, rs2v, rdv;  // operand values and result (the address, for loads before MemAccess)
+  InstTag::ID kind;
+  u8 rd, rs1, rs2;
+  bool cond, pred;      // branches: outcome once executed, and the prediction made at decode
+  FusedPair fusion;     // the head this micro-op absorbed, if any; `encoding` is then the head's
+  u8 headRd;            // register the absorbed head still writes, 0 if the tail overwrites it
+
+  /// the undecoded word at `pc` as it sits in the IF latch
+  static auto Fetched(const u32 encoding, const u32 pc) -> MicroOp {
+    MicroOp op{};
+    op.encoding = encoding;
+    op.pc = pc;
+    op.kind = InstTag::ID::Unknown;
+    return op;
+  }
+
+  /// decode `encoding` found at `pc` (see DecodeTable.hpp). Operand values
+  /// are left 0; use read() to fill them.
+  static auto Decode(const u32 encoding, const u32 pc) -> MicroOp;
+  /// the micro-op of an `encoding` already known to be `kind`
+  static auto Extract(const InstTag::ID kind, const u32 encoding, const u32 pc) -> MicroOp;
+
+  auto read(const RegisterFile &RF) -> void {
+    rs1v = RF[rs1];
+    rs2v = RF[rs2];
+  }
+
+  /// target of a taken branch or JAL
+  auto target() const -> u32 { return pc + imm; }
+  /// target of a JALR, once its operands are read
+  auto indirectTarget() const -> u32 { return (rs1v + imm) & ~1u; }
+  /// address a load or store accesses, between Execute and MemAccess
+  auto address() const -> u32 { return InstTag::IsLoad(kind) ? rdv : rs1v + imm; }
+  /// bytes a load or store accesses
+  auto width() const -> u32 {
+    using InstTag::ID;
+    if (kind == ID::LB or kind == ID::LBU or kind == ID::SB)
+      return 1;
+    return kind == ID::LH or kind == ID::LHU or kind == ID::SH ? 2 : 4;
+  }
+  /// value the absorbed LUI / AUIPC head writes to headRd
+  auto headValue() const -> u32 {
+    return (encoding & 0xfffff000u) + (GetOpcode(encoding) == InstTag::OPC_AUIPC ? pc - 4 : 0);
+  }
+
+  auto dump() const -> void;
+};
+
+inline auto MicroOp::Decode(const u32 encoding, const u32 pc) -> MicroOp {
+  return Extract(DecodeKind(encoding), encoding, pc);
+}
+
+static_assert(std::is_trivially_copyable_v<MicroOp>, "micro-ops are copied around by value");
+static_assert(sizeof(MicroOp) <= 32, "a micro-op should stay within half a cache line");
+
+//===----------------------------------------------------------------------===//
+// Semantics
+//===----------------------------------------------------------------------===//
+
+/// compute rdv (or cond) of an instruction statically known to be `Kind`
+template <InstTag::ID Kind>
+inline auto Execute(MicroOp &) -> void {}
+
+/// perform the memory access of a load / store statically known to be `Kind`
+template <InstTag::ID Kind>
+inline auto MemAccess(MicroOp &, Memory &) -> void {}
+
+#define semantics(MNEMONIC, stage) template <> inline auto stage<InstTag::ID::MNEMONIC>
+
+semantics(ADDI,  Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+semantics(SLTI,  Execute) (MicroOp &op) -> void { op.rdv = slt(op.rs1v, op.imm) ? 1 : 0; }
+semantics(SLTIU, Execute) (MicroOp &op) -> void { op.rdv = ult(op.rs1v, op.imm) ? 1 : 0; }
+semantics(ANDI,  Execute) (MicroOp &op) -> void { op.rdv = op.rs1v & op.imm; }
+semantics(ORI,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v | op.imm; }
+semantics(XORI,  Execute) (MicroOp &op) -> void { op.rdv = op.rs1v ^ op.imm; }
+semantics(SLLI,  Execute) (MicroOp &op) -> void { op.rdv = op.rs1v << op.imm; }
+semantics(SRLI,  Execute) (MicroOp &op) -> void { op.rdv = op.rs1v >> op.imm; }
+semantics(SRAI,  Execute) (MicroOp &op) -> void { op.rdv = AShiftR(op.rs1v, op.imm); }
+semantics(LUI,   Execute) (MicroOp &op) -> void { op.rdv = op.imm; }
+semantics(AUIPC, Execute) (MicroOp &op) -> void { op.rdv = op.pc + op.imm; }
+semantics(ADD,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.rs2v; }
+semantics(SUB,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v - op.rs2v; }
+semantics(SLT,   Execute) (MicroOp &op) -> void { op.rdv = slt(op.rs1v, op.rs2v) ? 1 : 0; }
+semantics(SLTU,  Execute) (MicroOp &op) -> void { op.rdv = ult(op.rs1v, op.rs2v) ? 1 : 0; }
+semantics(AND,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v & op.rs2v; }
+semantics(OR,    Execute) (MicroOp &op) -> void { op.rdv = op.rs1v | op.rs2v; }
+semantics(XOR,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v ^ op.rs2v; }
+semantics(SLL,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v << (op.rs2v & 0b11111u); }
+semantics(SRL,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v >> (op.rs2v & 0b11111u); }
+semantics(SRA,   Execute) (MicroOp &op) -> void { op.rdv = AShiftR(op.rs1v, op.rs2v & 0b11111u); }
+semantics(JAL,   Execute) (MicroOp &op) -> void { op.rdv = op.pc + 4; }
+semantics(JALR,  Execute) (MicroOp &op) -> void { op.rdv = op.pc + 4; }
+semantics(BEQ,   Execute) (MicroOp &op) -> void { op.cond = (op.rs1v == op.rs2v); }
+semantics(BNE,   Execute) (MicroOp &op) -> void { op.cond = (op.rs1v != op.rs2v); }
+semantics(BLT,   Execute) (MicroOp &op) -> void { op.cond = slt(op.rs1v, op.rs2v); }
+semantics(BLTU,  Execute) (MicroOp &op) -> void { op.cond = ult(op.rs1v, op.rs2v); }
+semantics(BGE,   Execute) (MicroOp &op) -> void { op.cond = sge(op.rs1v, op.rs2v); }
+semantics(BGEU,  Execute) (MicroOp &op) -> void { op.cond = uge(op.rs1v, op.rs2v); }
+semantics(LB,    Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+semantics(LH,    Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+semantics(LW,    Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+semantics(LBU,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+semantics(LHU,   Execute) (MicroOp &op) -> void { op.rdv = op.rs1v + op.imm; }
+
+semantics(LB,    MemAccess) (MicroOp &op, Memory &mem) -> void { op.rdv = SExt<8>(mem.load<u8>(op.rdv)); }
+semantics(LH,    MemAccess) (MicroOp &op, Memory &mem) -> void { op.rdv = SExt<16>(mem.load<u16>(op.rdv)); }
+semantics(LW,    MemAccess) (MicroOp &op, Memory &mem) -> void { op.rdv = mem.load<u32>(op.rdv); }
+semantics(LBU,   MemAccess) (MicroOp &op, Memory &mem) -> void { op.rdv = mem.load<u8>(op.rdv); }
+semantics(LHU,   MemAccess) (MicroOp &op, Memory &mem) -> void { op.rdv = mem.load<u16>(op.rdv); }
+semantics(SB,    MemAccess) (MicroOp &op, Memory &mem) -> void { mem.store<u8>(op.rs1v + op.imm, cast<u8>(op.rs2v)); }
+semantics(SH,    MemAccess) (MicroOp &op, Memory &mem) -> void { mem.store<u16>(op.rs1v + op.imm, cast<u16>(op.rs2v)); }
+semantics(SW,    MemAccess) (MicroOp &op, Memory &mem) -> void { mem.store<u32>(op.rs1v + op.imm, cast<u32>(op.rs2v)); }
+
+#undef semantics
+
+/// Execute / MemAccess of a micro-op whose kind is only known at run time
+#define GENCASE(MNEMONIC, ...) case InstTag::ID::MNEMONIC: return Execute<InstTag::ID::MNEMONIC>(op);
+inline auto Execute(MicroOp &op) -> void {
+  switch (op.kind) {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENCASE, GENCASE, GENCASE, GENCASE, GENCASE, GENCASE)
+  case InstTag::ID::Unknown: return;
+  }
+}
+#undef GENCASE
+
+#define GENCASE(MNEMONIC, ...) case InstTag::ID::MNEMONIC: return MemAccess<InstTag::ID::MNEMONIC>(op, mem);
+inline auto MemAccess(MicroOp &op, Memory &mem) -> void {
+  switch (op.kind) {
+    RV32I_INSTTAGS(INSTTAG_IGNORE, INSTTAG_IGNORE, GENCASE, GENCASE, INSTTAG_IGNORE, INSTTAG_IGNORE, INSTTAG_IGNORE)
+  default: return;
+  }
+}
+#undef GENCASE
+
+inline auto WriteBack(const MicroOp &op, RegisterFile &RF) -> void {
+  if (op.fusion != FusedPair::None)
+    RF[op.headRd] = op.headValue();
+  if (InstTag::WritesRd(op.kind))
+    RF[op.rd] = op.rdv;
+}
+
+/// execute a micro-op of statically known kind at `pc` to completion and
+/// return the next pc. The fall-through pc is derived from the caller's `pc`
+/// rather than reloaded from the micro-op, which keeps it off the load chain
+/// between dispatches.
+template <InstTag::ID Kind>
+inline auto Retire(MicroOp *op, const u32 pc, RegisterFile &RF, Memory &mem) -> u32 {
+  using namespace InstTag;
+  op->read(RF);
+  Execute<Kind>(*op);
+
+  if constexpr (IsLoad(Kind)) {
+    MemAccess<Kind>(*op, mem);
+    RF.writeThrough(op->rd, op->rdv);
+  } else if constexpr (IsStore(Kind)) {
+    MemAccess<Kind>(*op, mem);
+  } else if constexpr (IsBranch(Kind)) {
+    return op->cond ? pc + op->imm : pc + 4;
+  } else if constexpr (Kind == ID::JAL) {
+    RF.writeThrough(op->rd, op->rdv);
+    return pc + op->imm;
+  } else if constexpr (Kind == ID::JALR) {
+    RF.writeThrough(op->rd, op->rdv);
+    return op->indirectTarget();
+  } else if constexpr (Kind != ID::Unknown) {
+    RF.writeThrough(op->rd, op->rdv);
+  }
+  return pc + 4;
+}
@@ -5,7 +5,7 @@
 struct SaturatingCounter {
   u8 prediction;
 
-  SaturatingCounter() = default;
+  SaturatingCounter(): prediction(0) {}
   ~SaturatingCounter() = default;
 
   auto predict() const -> bool {
@@ -27,10 +27,10 @@ struct SaturatingCounter {
 
 template <u32 N>
 struct TwoLevelAdaptivePredictor {
-  SaturatingCounter counter[MEMORY_SIZE << (N - 2)];
-  u8 history[MEMORY_SIZE >> 2];
+  SaturatingCounter counter[CODE_SIZE << (N - 2)];
+  u8 history[CODE_SIZE >> 2];
 
-  TwoLevelAdaptivePredictor() = default;
+  TwoLevelAdaptivePredictor(): counter{}, history{} {}
   ~TwoLevelAdaptivePredictor() = default;
 
   auto getCounterEntry(const u32 pc) const
@@ -61,7 +61,7 @@ struct TwoLevelAdaptivePredictor {
 struct Predictor {
   TwoLevelAdaptivePredictor<2> impl;
 
-  Predictor() = default;
+  Predictor(): impl{}, hit(0), total(0) {}
   ~Predictor() = default;
 
   mutable u64 hit, total;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "config.hpp"
+#include "Cache.hpp"
+
+#include <vector>
+
+/// a hardware data prefetcher: it watches the demand accesses of a cache and
+/// starts fetching the lines it expects next into it (see Cache::prefetch).
+/// How well that works is counted by the cache, where the lines land.
+struct Prefetcher {
+  /// a reference prediction table entry: the last address of the load or
+  /// store at `pc` and the stride it has been seen to step by
+  struct Entry {
+    u32 pc;
+    u32 last;
+    u32 stride;
+    u8 valid;
+    u8 confidence;  // 0 to 3: matching strides count up, others down; 2 and up issue prefetches
+    u16 pad;
+  };
+  static_assert(sizeof(Entry) == 16);
+
+  PrefetchConfig config;
+  std::vector<Entry> table;
+
+  explicit Prefetcher(const PrefetchConfig &configured): config(configured),
+    table(configured.policy == PrefetchPolicy::Stride ? configured.entries : 0) {}
+
+  static constexpr auto Valid(const PrefetchConfig &config) -> bool {
+    return config.policy != PrefetchPolicy::Stride
+      or (config.entries != 0 and (config.entries & (config.entries - 1)) == 0);
+  }
+
+  /// learn from the demand access of `address` by the instruction at `pc`,
+  /// which `access` describes, and prefetch into `cache` at cycle `now`
+  auto observe(const u32 pc, const u32 address, const Cache::Access &access, Cache &cache, const u64 now) -> void {
+    switch (config.policy) {
+    case PrefetchPolicy::None:
+      return;
+    case PrefetchPolicy::NextLine: {
+      // tagged: a line used first after a prefetch keeps the stream going, as a miss starts one
+      if (access.hit and !access.prefetchHit)
+        return;
+      const u32 line = address >> cache.lineBits;
+      for (u32 ahead = 1; ahead <= config.degree; ++ahead)
+        cache.prefetch((line + ahead) << cache.lineBits, now);
+      return;
+    }
+    case PrefetchPolicy::Stride: {
+      Entry &entry = table[(pc >> 2) & (config.entries - 1)];
+      if (!entry.valid or entry.pc != pc) {
+        entry = Entry{pc, address, 0, true, 0, 0};
+        return;
+      }
+      const u32 stride = address - entry.last;
+      entry.last = address;
+      if (stride == entry.stride) {
+        if (entry.confidence < 3)
+          ++entry.confidence;
+      } else if (entry.confidence > 0)
+        --entry.confidence;
+      else
+        entry.stride = stride;
+      if (entry.confidence < 2 or entry.stride == 0)
+        return;
+      // strides shorter than a line would fetch the same line `degree` times: step by lines then
+      const i32 steady = static_cast<i32>(entry.stride), lineSize = static_cast<i32>(cache.config.lineSize);
+      const i32 step = steady > -lineSize and steady < lineSize ? (steady < 0 ? -lineSize : lineSize) : steady;
+      for (u32 ahead = 1; ahead <= config.degree; ++ahead)
+        cache.prefetch(address + ahead * static_cast<u32>(step), now);
+      return;
+    }
+    }
+  }
+};
+
+static_assert(Prefetcher::Valid(L1DPrefetch), "see PrefetchConfig");
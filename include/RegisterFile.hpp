@@ -33,6 +33,15 @@ struct RegisterFile {
     return x[sel];
   }
 
+  /// write `value` to x[sel] and make it visible at once, for engines without
+  /// a write-back stage. writes to x0 are dropped.
+  auto writeThrough(const u32 sel, const u32 value) -> void {
+    if (sel != 0) {
+      x[sel] = value;
+      x[sel].tick();
+    }
+  }
+
   auto tick() -> void {
     [this]<u32... Index>(std::integer_sequence<u32, Index...>) {
       ((x[Index + 1].tick()), ...);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "config.hpp"
+#include "Executor.hpp"
+
+/// how a sampled run alternates the engines (see RunSampled)
+struct SamplingOptions {
+  u64 period = SamplePeriod;  // instructions fast-forwarded functionally before each sample
+  u64 warmup = SampleWarmup;  // pipeline cycles run, and not measured, before each sample
+  u64 window = SampleWindow;  // pipeline cycles each sample measures
+};
+
+/// a ratio estimated from the samples
+struct Estimate {
+  f64 value;
+  f64 error;  // half-width of its 95% confidence interval; 0 with fewer than two samples
+};
+
+/// outcome of a sampled run
+struct SampledRun {
+  bool faulted;       // a guest fault stopped it; ret is then 0
+  u32 ret;            // exit value, as ./code prints it
+  u64 instret;        // instructions retired, fast-forwarded or in the pipeline
+  u64 samples;        // windows measured; a window the program ended in is dropped
+  u64 detailedCycles; // pipeline cycles simulated, warm-up included
+  Estimate cpi;       // clock cycles per instruction
+  Estimate accuracy;  // predictor hit rate, as Predictor::hitRate() counts it
+
+  /// the estimated clock cycles of a full pipeline run, with their interval
+  auto cycles() const -> Estimate {
+    return Estimate{cpi.value * (f64)instret, cpi.error * (f64)instret};
+  }
+};
+
+/// run the program loaded into `executor` (or the checkpoint restored into
+/// it) to the end, simulating only part of it cycle by cycle: every
+/// `period` instructions of the functional engine, the pipeline runs
+/// `warmup` cycles to refill itself and the predictor, then measures a
+/// window of `window` cycles. The instructions still in flight are then
+/// squashed and the functional engine goes on. CPI and branch accuracy are
+/// ratio estimates over the windows.
+auto RunSampled(Executor &executor, const SamplingOptions &options = {}) -> SampledRun;
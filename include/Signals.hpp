@@ -23,7 +23,7 @@ struct StallSignal {
   u32 stallTimeCount;
   bool insertBubble;
 
-  StallSignal() = default;
+  StallSignal(): stallPos(0), stallTimeCount(0), insertBubble(false) {}
   ~StallSignal() = default;
 
   template <typename StallStage>
@@ -59,7 +59,7 @@ struct KillSignal {
   using ID  = StageTag<2>;
   using EX  = StageTag<3>;
 
-  KillSignal() = default;
+  KillSignal(): killPos(0) {}
   ~KillSignal() = default;
 
   u32 killPos;
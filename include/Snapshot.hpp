@@ -0,0 +1,55 @@
+#pragma once
+
+#include "config.hpp"
+#include "Elf.hpp"
+
+#include <vector>
+
+struct Memory;
+
+/// a loaded image saved as its nonzero bytes, to be loaded back with one
+/// copy per extent and no parsing:
+///
+///   SnapshotHeader
+///   SnapshotExtent[extents]   address and length of every nonzero run
+///   the bytes of every extent, back to back
+///
+/// all little-endian. The checksum covers the header fields after it, the
+/// extent table and the bytes.
+struct SnapshotHeader {
+  static constexpr char Magic[8] = {'R', 'V', '3', '2', 'S', 'N', 'A', 'P'};
+  static constexpr u32 CurrentVersion = 1;
+
+  char magic[8];
+  u64 checksum;
+  u32 version;
+  u32 entry;       // pc the program starts at
+  u32 pages;       // pages the extents touch, what loading it allocates
+  u32 extents;
+};
+static_assert(sizeof(SnapshotHeader) == 32);
+
+struct SnapshotExtent {
+  u32 address;
+  u32 size;
+};
+
+/// a hash of [data, data + size) to catch truncation and bit rot in the
+/// binary formats, at memcpy-like speed
+auto WordChecksum(const char *data, const std::size_t size) -> u64;
+
+/// runs of nonzero bytes in `mem`, by address, joining runs separated by
+/// fewer than `gap` zero bytes, which are cheaper to store than an extent
+auto NonzeroExtents(const Memory &mem, const u32 gap = 2 * sizeof(SnapshotExtent)) -> std::vector<SnapshotExtent>;
+
+/// the snapshot of `mem` for a program starting at `entry`
+auto WriteSnapshot(const Memory &mem, const u32 entry) -> std::string;
+
+/// [begin, end) starts with the snapshot magic
+auto IsSnapshot(const char *begin, const char *end) -> bool;
+
+/// copy the extents of the snapshot [begin, end) into `mem`, which is all
+/// zero; nothing outside them is written. nullopt, after logging why, if the
+/// snapshot is truncated, fails its checksum or has an entry point that is
+/// not below CODE_SIZE.
+auto LoadSnapshot(const char *begin, const char *end, Memory &mem) -> std::optional<ProgramInfo>;
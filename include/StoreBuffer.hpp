@@ -0,0 +1,109 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <vector>
+
+/// stores on their way from the memory stage to the data cache. A store
+/// leaves MEM as soon as it has an entry, and the entries are written, in
+/// order and one at a time, in the background; a load whose bytes are all
+/// in the buffer takes them from there. Like the caches it holds no data:
+/// memory is written when the store leaves MEM, so a load reads the right
+/// value either way, and the buffer only decides how long the access takes.
+///
+/// Time moves on lazily: the buffer is only looked at when MEM stores or
+/// loads, and retires then whatever finished writing since. `Port` is how it
+/// reaches memory, `port(instPc, address, write, at)` returning the cycles an
+/// access from cycle `at` takes.
+struct StoreBuffer {
+  struct Entry {
+    u32 pc;       // of the store, for a prefetcher to train on when it is written
+    u32 address;
+    u32 width;    // bytes
+  };
+  static_assert(sizeof(Entry) == 12);
+
+  std::vector<Entry> entries;  // a ring, the oldest at `head`
+  u32 head, count;
+  u64 headDoneAt;   // cycle the oldest entry is written, when there is one
+  u64 stores;
+  u64 fullStalls, fullStallCycles;       // stores that found the buffer full, and the cycles they waited for room
+  u64 forwards;                          // loads whose bytes all came from the buffer
+  u64 overlapStalls, overlapStallCycles; // loads only partly in it, which waited for those stores to be written
+
+  explicit StoreBuffer(const u32 depth): entries(depth), head(0), count(0), headDoneAt(0), stores(0), fullStalls(0),
+    fullStallCycles(0), forwards(0), overlapStalls(0), overlapStallCycles(0) {}
+
+  /// retire the entries written by cycle `now`
+  template <typename Port>
+  auto settle(const u64 now, Port &&port) -> void {
+    while (count > 0 and headDoneAt <= now)
+      retire(port);
+  }
+
+  /// take the store of `width` bytes at `address` at cycle `now`; the cycles
+  /// it waits for an entry to free up first
+  template <typename Port>
+  auto push(const u32 storePc, const u32 address, const u32 width, const u64 now, Port &&port) -> u32 {
+    settle(now, port);
+    u32 wait = 0;
+    if (count == entries.size()) {
+      wait = static_cast<u32>(headDoneAt - now);
+      ++fullStalls;
+      fullStallCycles += wait;
+      retire(port);
+    }
+    entries[(head + count) % entries.size()] = Entry{storePc, address, width};
+    ++count;
+    ++stores;
+    if (count == 1)
+      headDoneAt = now + wait + port(storePc, address, true, now + wait);
+    return wait;
+  }
+
+  /// cycles the load of `width` bytes at `address` takes from cycle `now`:
+  /// the stage's own cycle if the buffer holds all its bytes, however many
+  /// stores wrote them. One that overlaps the buffer only in part, say a LW
+  /// over an SB, waits for the overlapping stores to be written, then reads
+  /// through `port` like any other load.
+  template <typename Port>
+  auto load(const u32 loadPc, const u32 address, const u32 width, const u64 now, Port &&port) -> u32 {
+    settle(now, port);
+    u32 covered = 0, overlapping = 0;  // bytes of the load in the buffer; entries up to the youngest of them
+    for (u32 i = 0; i < count; ++i) {
+      const Entry &entry = entries[(head + i) % entries.size()];
+      u32 written = 0;
+      for (u32 byte = 0; byte < width; ++byte)
+        written |= u32(address + byte - entry.address < entry.width) << byte;
+      covered |= written;
+      if (written != 0)
+        overlapping = i + 1;
+    }
+    if (covered == 0)
+      return port(loadPc, address, false, now);
+    if (covered == (1u << width) - 1) {
+      ++forwards;
+      return 1;
+    }
+    u64 at = now;
+    for (; overlapping > 0; --overlapping)
+      at = retire(port);
+    const u32 wait = static_cast<u32>(at - now);
+    ++overlapStalls;
+    overlapStallCycles += wait;
+    return wait + port(loadPc, address, false, at);
+  }
+
+private:
+  /// drop the oldest entry once it is written and start writing the next;
+  /// the cycle it was written
+  template <typename Port>
+  auto retire(Port &&port) -> u64 {
+    const u64 done = headDoneAt;
+    head = head + 1 == entries.size() ? 0 : head + 1;
+    --count;
+    if (count > 0)
+      headDoneAt = done + port(entries[head].pc, entries[head].address, true, done);
+    return done;
+  }
+};
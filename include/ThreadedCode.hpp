@@ -0,0 +1,77 @@
+#pragma once
+
+#include "config.hpp"
+#include "InstTag.hpp"
+#include "Memory.hpp"
+#include "RegisterFile.hpp"
+#include "MicroOp.hpp"
+
+#if defined(__GNUC__)
+  #define THREADED_COMPUTED_GOTO 1  // labels as values: dispatch with `goto *handler`
+#else
+  #define THREADED_COMPUTED_GOTO 0  // portable fallback: dispatch with a switch
+#endif
+
+/// handlers of the threaded-code interpreter: two internal ones followed by
+/// one per instruction, generated from RV32I_INSTTAGS
+namespace Handler {
+  #define GENHANDLER(MNEMONIC, ...) MNEMONIC,
+  enum Index: u32 {
+    Translate,  // first execution of a word: decode it and patch the op
+    Halt,       // HaltEncoding reached
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER)
+    Unknown,
+    NumHandlers,
+  };
+  #undef GENHANDLER
+
+  constexpr auto of(const InstTag::ID id) -> Index {
+    return static_cast<Index>(static_cast<u32>(id) + Halt + 1);
+  }
+}
+
+/// PC-indexed threaded code: every word of guest memory maps to one op holding
+/// its handler and its decoded operands. Ops start out (and are reset on guest
+/// stores) as Translate, which decodes the word on first execution.
+struct ThreadedCode: MemoryObserver {
+  static constexpr u32 Capacity = CODE_SIZE >> 2;
+
+  struct Op {
+#if THREADED_COMPUTED_GOTO
+    const void *handler;  // label address inside Executor::runThreaded
+#else
+    u32 handler;          // Handler::Index
+#endif
+    MicroOp *inst;        // decoded operands, owned by the decode cache
+  };
+
+  std::unique_ptr<Op[]> ops;
+  Op blank;               // what an untranslated op looks like
+  u64 translations;
+
+  ThreadedCode(): ops(std::make_unique<Op[]>(Capacity)), blank{}, translations(0) {}
+  ~ThreadedCode() = default;
+
+  ThreadedCode(const ThreadedCode &) = delete;
+  auto operator= (const ThreadedCode &) -> ThreadedCode& = delete;
+
+#if THREADED_COMPUTED_GOTO
+  /// label addresses are only known inside the interpreter, which binds the
+  /// Translate label before running
+  auto bind(const void *translate) -> void {
+    if (blank.handler == translate)
+      return;
+    blank.handler = translate;
+    for (u32 index = 0; index < Capacity; ++index)
+      ops[index] = blank;
+  }
+#endif
+
+  auto invalidate(const u32 address, const u32 size) -> void override {
+    if (size == 0 or address >= CODE_SIZE)
+      return;
+    const u32 last = std::min(address + size - 1, CODE_SIZE - 1) >> 2;
+    for (u32 index = address >> 2; index <= last; ++index)
+      ops[index] = blank;
+  }
+};
@@ -19,13 +19,11 @@ constexpr inline auto match(const u32 bits) -> bool {
 }
 
 template <u32 length>
-inline auto SExt(const u32 bits) -> u32 {
+constexpr inline auto SExt(const u32 bits) -> u32 {
   if constexpr (length >= 32u)
     return bits;
-  std::bitset<32> b = bits;
-  for (u32 i = length; i < 32; ++i)
-    b[i] = b[length - 1];
-  return b.to_ulong();
+  else  // move the sign bit to bit 31 and shift it back arithmetically
+    return cast<u32>(cast<i32>(bits << (32 - length)) >> (32 - length));
 }
 
 inline auto SExt(const u32 bits, const u32 length) -> u32 {
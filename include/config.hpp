@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <cassert>
@@ -11,6 +12,7 @@
 #include <algorithm>
 
 #include <tuple>
+#include <optional>
 #include <bitset>
 #include <memory>
 #include <type_traits>
@@ -29,8 +31,83 @@ using f32 = float;
 using f64 = double;
 
 constexpr bool NOASSERT                      = false;
-constexpr u32 MEMORY_SIZE                    = 0x20000;
+constexpr u32 CODE_SIZE                      = 0x20000;  // code lies below it, where the per-pc tables reach; data may be anywhere
+constexpr u64 MemoryLimit                    = 1ull << 30; // guest memory a program may write before a store faults
 constexpr bool UseTwoLevelAdaptivePredictor  = true;
+constexpr bool UseDecodeCache                = true;     // reuse decoded instructions by PC
+constexpr u32 HaltEncoding                   = 0x0ff00513u; // li a0, 255: the simulation ends here
+constexpr bool UseJit                        = true;     // compile hot blocks to native code in --engine=jit
+constexpr u32 JitThreshold                   = 16;       // interpreted executions before a block is compiled
+
+/// how --engine=pipeline times a pair fused by --fuse
+enum struct FusionTiming {
+  OneSlot,  // the pair is fetched and issued together and takes one slot down the pipeline
+  TwoSlots, // fetch still delivers one word per cycle, so the tail's slot turns into a bubble
+};
+constexpr FusionTiming PipelineFusionTiming  = FusionTiming::OneSlot;
+constexpr u64 SamplePeriod                   = 10000;    // instructions --sample fast-forwards functionally before each sample
+constexpr u64 SampleWarmup                   = 500;      // pipeline cycles that warm the predictor and fill the pipeline before a sample
+constexpr u64 SampleWindow                   = 500;      // pipeline cycles a sample measures
+constexpr u64 IntervalLength                 = 100000;   // instructions per interval of --intervals
+constexpr u64 IntervalWarmup                 = 10000;    // instructions each interval is preceded by in the pipeline, unmeasured
+
+/// how a cache picks the way a fill evicts, once every way of the set is valid
+enum struct Replacement {
+  LRU,    // the least recently used way
+  PLRU,   // the way a binary tree of most-recent bits points away from
+  Random, // a pseudo-random way, from a fixed seed so runs repeat
+};
+
+/// geometry, policy and timing of a cache (see Cache.hpp). size, ways and
+/// lineSize are powers of two.
+struct CacheConfig {
+  u32 size;            // bytes of data
+  u32 ways;
+  u32 lineSize;        // bytes
+  Replacement replacement;
+  bool writeBack;      // a store only dirties its line, written back on eviction; else it is written through
+  bool writeAllocate;  // a store that misses fills its line; else it goes to memory around the cache
+  u32 hitLatency;      // cycles of an access that hits; 1 is the stage's own cycle
+  u32 missLatency;     // cycles memory takes to move a line in or out, or to take a written-through store, without UseDram
+};
+constexpr bool UseCaches                     = true;     // time fetches and loads / stores in the pipeline through L1 caches
+constexpr CacheConfig L1ICache               = {16 << 10, 4, 64, Replacement::LRU, true, true, 1, 20};
+constexpr CacheConfig L1DCache               = {16 << 10, 4, 64, Replacement::LRU, true, true, 1, 20};
+
+/// what the data prefetcher (see Prefetcher.hpp) fetches ahead of the pipeline's loads and stores
+enum struct PrefetchPolicy {
+  None,
+  NextLine, // the lines after one a demand access missed, or used first after a prefetch
+  Stride,   // by pc, the addresses the next steps of a confirmed stride lead to, a line at least per step
+};
+struct PrefetchConfig {
+  PrefetchPolicy policy;
+  u32 degree;   // lines (NextLine) or steps (Stride) fetched ahead
+  u32 entries;  // reference prediction table entries, a power of two, for Stride
+};
+constexpr PrefetchConfig L1DPrefetch         = {PrefetchPolicy::Stride, 1, 64};
+
+/// what a DRAM bank does with its row once an access is done
+enum struct RowPolicy {
+  Open,   // keep it open: the next access to it skips the activation, one to another row precharges first
+  Closed, // precharge it at once: every access activates its row, and none waits for a precharge
+};
+
+/// banks, row buffer policy and timing, in pipeline cycles, of main memory
+/// behind the caches (see Dram.hpp). banks and rowSize are powers of two.
+struct DramConfig {
+  u32 banks;
+  u32 rowSize;    // bytes of a row; consecutive rows go to consecutive banks
+  RowPolicy policy;
+  u32 tRCD;       // activating a row, before a column of it can be read or written
+  u32 tCAS;       // a read or write of a column of the open row, to the line moved
+  u32 tRP;        // precharging the open row, before another can be activated
+};
+constexpr bool UseDram                       = true;     // time cache misses through MainMemory; else each costs the cache's missLatency
+constexpr DramConfig MainMemory              = {8, 2 << 10, RowPolicy::Open, 10, 10, 10};
+constexpr u32 StoreBufferDepth               = 8;        // stores MEM hands on to be written in the background; 0 for none, so each waits for its write
+constexpr u32 FlatMemoryLatency              = 3;        // cycles of every load and store without UseCaches or UseDram
+constexpr u32 LockstepLanes                  = 16;       // harts per --lockstep group: 16 fill an AVX-512 register, 8 an AVX2 one
 
 constexpr char const * regname_[2][32] = {
   {
@@ -49,12 +126,21 @@ constexpr char const * regname_[2][32] = {
 
 namespace DumpOptions {
   constexpr bool TrackMemOp             = false;    // track memory operations
-  constexpr bool DumpInst               = true;    // dump instructions
+  constexpr bool DumpInst               = false;    // dump instructions
   constexpr bool DumpRegState           = false;    // dump register states **every instruction**
   constexpr bool DumpRetValue           = false;    // dump return value
   constexpr bool DumpTargetAddr         = true;    // dump target address instead of offset in Branch/Jump instructions
   constexpr bool DumpTotalClockCycle    = false;    // dump total clock cycles
   constexpr bool DumpPredictionAccuracy = false;    // dump prediction accuracy
+  constexpr bool DumpCacheStats         = false;    // dump hits / misses / evictions of the L1 caches, with UseCaches
+  constexpr bool DumpDramStats          = false;    // dump row hits / misses / conflicts and bank waits of main memory, with UseDram
+  constexpr bool DumpStoreBufferStats   = false;    // dump stores, full-buffer stalls and forwarded loads, with a StoreBufferDepth
+  constexpr bool DumpAllocStats         = false;    // dump heap allocations made by the pipeline
+  constexpr bool DumpDecodeCacheStats   = false;    // dump decode cache hits / misses / invalidations
+  constexpr bool DumpBlockCacheStats    = false;    // dump basic-block translations, flushes and chaining
+  constexpr bool DumpJitStats           = false;    // dump compiled blocks and code size
+  constexpr bool DumpFusionStats        = false;    // dump fused pairs retired, with --fuse
+  constexpr bool DumpLockstepStats      = false;    // dump steps and lane utilization of every --lockstep group
   constexpr bool DumpTotalTime          = false;    // dump total time used
   constexpr bool UseABIname             = true;     // dump registers with their ABI name
   constexpr u32 ClkLimit                = 0;        // exit after executing ClkLimit clock cycles
@@ -75,7 +161,6 @@ inline auto LOG(const char *str) -> i32 {
 
 constexpr const char *const * regname = regname_[DumpOptions::UseABIname];
 
-struct Instruction;
-using InstPtr = std::shared_ptr<Instruction>;
+struct MicroOp;
 
 struct Executor;
@@ -0,0 +1,100 @@
+#include "Batch.hpp"
+#include "Lockstep.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+  auto Elapsed(const std::chrono::steady_clock::time_point start) -> f64 {
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  auto RunOne(const std::string &file, const BatchOptions &options) -> BatchResult {
+    BatchResult result{};
+    result.file = file;
+    const auto loadStart = std::chrono::steady_clock::now();
+    const std::optional<ImageText> text = ImageText::open(file.c_str());
+    if (!text)
+      return result;
+
+    // an Executor is too large for a worker's stack
+    auto executor = std::make_unique<Executor>();
+    executor->fuse = options.fuse;
+    if (!executor->initMem(*text) or !executor->runnableOn(options.engine))
+      return result;
+    result.loaded = true;
+    result.loadMs = Elapsed(loadStart);
+
+    const auto start = std::chrono::steady_clock::now();
+    result.ret = executor->run(options.engine);
+    result.faulted = executor->mem.fault.has_value();
+    result.instret = executor->instret;
+    result.ms = Elapsed(start);
+    return result;
+  }
+
+  /// files[first, first + count) as the lanes of one group
+  auto RunGroup(const std::vector<std::string> &files, const std::size_t first, const u32 count,
+                BatchResult *results) -> void {
+    auto group = std::make_unique<LockstepGroup>();
+    for (u32 lane = 0; lane < count; ++lane) {
+      results[lane] = BatchResult{files[first + lane], false, false, 0, 0, 0, 0};
+      const auto loadStart = std::chrono::steady_clock::now();
+      const std::optional<ImageText> text = ImageText::open(files[first + lane].c_str());
+      if (!text or !group->load(lane, *text))
+        continue;
+      results[lane].loaded = true;
+      results[lane].loadMs = Elapsed(loadStart);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    group->run();
+    const f64 ms = Elapsed(start);
+    for (u32 lane = 0; lane < count; ++lane)
+      if (results[lane].loaded) {
+        results[lane].faulted = (group->faulted >> lane) & 1u;
+        results[lane].ret = group->ret[lane];
+        results[lane].instret = group->instret[lane];
+        results[lane].ms = ms;
+      }
+    if constexpr (DumpOptions::DumpLockstepStats)
+      LOG("lockstep group:       %s.. (%u lanes), %llu steps, %.2lf of %u lanes active per step\n",
+        files[first].c_str(), count, group->steps, group->utilization(), LockstepGroup::Lanes);
+  }
+}
+
+auto RunBatch(const std::vector<std::string> &files, const BatchOptions &options) -> std::vector<BatchResult> {
+  std::vector<BatchResult> results(files.size());
+  // a unit of work is a program, or a group of LockstepLanes programs
+  const std::size_t unit = options.lockstep ? LockstepGroup::Lanes : 1;
+  const std::size_t units = (files.size() + unit - 1) / unit;
+  std::atomic<std::size_t> next{0};
+  const auto work = [&] {
+    for (std::size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < units;) {
+      if (!options.lockstep) {
+        results[index] = RunOne(files[index], options);
+        continue;
+      }
+      const std::size_t first = index * unit;
+      RunGroup(files, first, static_cast<u32>(std::min(unit, files.size() - first)), &results[first]);
+    }
+  };
+
+  const u32 workers = static_cast<u32>(std::min<std::size_t>(std::max(options.jobs, 1u), units));
+  if (workers <= 1) {
+    work();
+    return results;
+  }
+  std::vector<std::thread> pool;
+  pool.reserve(workers);
+  for (u32 i = 0; i < workers; ++i)
+    pool.emplace_back(work);
+  for (std::thread &worker : pool)
+    worker.join();
+  return results;
+}
+
+auto DefaultJobs() -> u32 {
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
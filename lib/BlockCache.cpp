@@ -0,0 +1,100 @@
+#include "Executor.hpp"
+
+//===----------------------------------------------------------------------===//
+// Basic-block translation
+//===----------------------------------------------------------------------===//
+
+auto Executor::translateBlock(const u32 start) -> Block * {
+  auto block = std::make_unique<Block>(start);
+  for (u32 address = start; address < CODE_SIZE; address += 4) {
+    MicroOp *inst = decodeCache.fetch(mem, address);
+    if (inst->encoding == HaltEncoding) {
+      block->halt = block->ops.empty();
+      break;
+    }
+
+    block->ops.push_back(Block::Op{BlockSteps[static_cast<u32>(inst->kind)], inst});
+    block->end = address + 4;
+
+    if (InstTag::IsControl(inst->kind))
+      break;
+    if (block->ops.size() == BlockCache::MaxBlockLength)
+      break;
+  }
+  return blockCache.insert(std::move(block));
+}
+
+auto Executor::runBlocks() -> u32 {
+  u32 npc = pc;
+  Block *block = nullptr;
+
+  for (;;) {
+    if (blockCache.dirty) {
+      blockCache.flush();
+      block = nullptr;
+    }
+    if (block == nullptr) {
+      ++blockCache.dispatched;
+      if constexpr (!NOASSERT)
+        assert(npc < CODE_SIZE && "pc exceeds CODE_SIZE");
+      block = blockCache.lookup(npc);
+      if (block == nullptr)
+        block = translateBlock(npc);
+    }
+
+    if (block->halt) {
+      halted = true;
+      dumpFunctionalStats();
+      break;
+    }
+
+    u32 cur = block->start;
+    const Block::Op *const first = block->ops.data();
+    const Block::Op *const last = first + block->ops.size();
+    const Block::Op *op = first;
+    while (op != last) {
+      npc = op->step(op->inst, cur, RF, mem);
+      cur += 4;
+
+      if constexpr (DumpOptions::DumpInst)
+        op->inst->dump();
+      if constexpr (DumpOptions::DumpRegState) {
+        RF.dump();
+        LOG("\n\n");
+      }
+      ++op;
+      if constexpr (DumpOptions::ClkLimit > 0)
+        if (instret + u64(op - first) >= DumpOptions::ClkLimit) {
+          instret += u64(op - first);
+          goto done;
+        }
+
+      // a store hit translated code: leave before running stale ops
+      if (blockCache.dirty)
+        break;
+    }
+    instret += u64(op - first);
+
+    if (blockCache.dirty)
+      continue;
+
+    if (Block *next = block->successor(npc)) {
+      ++blockCache.chained;
+      block = next;
+      continue;
+    }
+
+    ++blockCache.dispatched;
+    if constexpr (!NOASSERT)
+      assert(npc < CODE_SIZE && "pc exceeds CODE_SIZE");
+    Block *next = blockCache.lookup(npc);
+    if (next == nullptr)
+      next = translateBlock(npc);
+    block->link(npc, next);
+    block = next;
+  }
+
+done:
+  pc = npc; pc.tick();
+  return RF[10] & 255u;
+}
@@ -0,0 +1,421 @@
+#include "Checkpoint.hpp"
+#include "Executor.hpp"
+
+#include <array>
+#include <vector>
+
+namespace {
+  constexpr std::size_t AfterChecksum = offsetof(CheckpointHeader, checksum) + sizeof(u64);
+
+  struct Writer {
+    std::string out;
+
+    template <typename T>
+    auto put(const T &value) -> void {
+      static_assert(std::is_trivially_copyable_v<T>);
+      out.append(reinterpret_cast<const char *>(&value), sizeof value);
+    }
+
+    auto latch(const Executor::Latch &latch) -> void {
+      put(static_cast<u8>(latch.has_value()));
+      put(latch.value_or(MicroOp{}));
+    }
+
+    /// runs of nonzero bytes of [data, data + size) as SnapshotExtents,
+    /// joined across fewer than 16 zero bytes
+    auto sparse(const u8 *data, const u32 size) -> void {
+      std::vector<SnapshotExtent> extents;
+      for (u32 offset = 0; offset < size; ++offset) {
+        if (data[offset] == 0)
+          continue;
+        SnapshotExtent *last = extents.empty() ? nullptr : &extents.back();
+        if (last != nullptr and offset - (last->address + last->size) < 16)
+          last->size = offset + 1 - last->address;
+        else
+          extents.push_back(SnapshotExtent{offset, 1});
+      }
+      put(static_cast<u32>(extents.size()));
+      out.append(reinterpret_cast<const char *>(extents.data()), extents.size() * sizeof(SnapshotExtent));
+      for (const SnapshotExtent &extent : extents)
+        out.append(reinterpret_cast<const char *>(data + extent.address), extent.size);
+    }
+  };
+
+  /// reads fields off [at, end); every read after the first that runs past
+  /// the end fails and yields zeros
+  struct Reader {
+    const char *at, *end;
+    bool ok = true;
+
+    auto take(void *data, const std::size_t size) -> void {
+      if (!ok or static_cast<std::size_t>(end - at) < size) {
+        ok = false;
+        std::memset(data, 0, size);
+        return;
+      }
+      std::memcpy(data, at, size);
+      at += size;
+    }
+
+    template <typename T>
+    auto get() -> T {
+      static_assert(std::is_trivially_copyable_v<T>);
+      T value;
+      take(&value, sizeof value);
+      return value;
+    }
+
+    auto latch() -> Executor::Latch {
+      const bool present = get<u8>() != 0;
+      const MicroOp op = get<MicroOp>();
+      if (present and (static_cast<u32>(op.kind) >= InstTag::NumIDs or static_cast<u32>(op.fusion) >= NumFusedPairs
+                       or op.rd >= 32 or op.rs1 >= 32 or op.rs2 >= 32 or op.headRd >= 32 or op.pc >= CODE_SIZE))
+        ok = false;
+      return present ? Executor::Latch{op} : std::nullopt;
+    }
+
+    /// a sparse blob that fits in `size` bytes: its extent table and bytes
+    struct Sparse {
+      std::vector<SnapshotExtent> extents;
+      const char *bytes;
+    };
+
+    auto sparse(const u64 size) -> Sparse {
+      const u32 count = get<u32>();
+      if (!ok or static_cast<std::size_t>(end - at) / sizeof(SnapshotExtent) < count) {
+        ok = false;
+        return Sparse{};
+      }
+      Sparse blob{std::vector<SnapshotExtent>(count), nullptr};
+      take(blob.extents.data(), blob.extents.size() * sizeof(SnapshotExtent));
+      u64 total = 0;
+      for (const SnapshotExtent &extent : blob.extents) {
+        if ((u64)extent.address + extent.size > size)
+          ok = false;
+        total += extent.size;
+      }
+      if (!ok or static_cast<u64>(end - at) < total) {
+        ok = false;
+        return Sparse{};
+      }
+      blob.bytes = at;
+      at += total;
+      return blob;
+    }
+  };
+
+  /// copy a sparse blob into [data, data + size), zeroing the rest
+  auto Unpack(const Reader::Sparse &blob, u8 *data, const u32 size) -> void {
+    std::memset(data, 0, size);
+    const char *bytes = blob.bytes;
+    for (const SnapshotExtent &extent : blob.extents) {
+      std::memcpy(data + extent.address, bytes, extent.size);
+      bytes += extent.size;
+    }
+  }
+
+  /// the fields of a CacheConfig, as a checkpoint stores them to be compared on loading
+  auto ConfigFields(const CacheConfig &config) -> std::array<u32, 8> {
+    return {config.size, config.ways, config.lineSize, static_cast<u32>(config.replacement),
+            u32(config.writeBack), u32(config.writeAllocate), config.hitLatency, config.missLatency};
+  }
+
+  /// the fields of a PrefetchConfig, likewise
+  auto PrefetcherFields(const PrefetchConfig &config) -> std::array<u32, 3> {
+    return {static_cast<u32>(config.policy), config.degree, config.entries};
+  }
+
+  /// the fields of a DramConfig, likewise
+  auto DramFields(const DramConfig &config) -> std::array<u32, 6> {
+    return {config.banks, config.rowSize, static_cast<u32>(config.policy), config.tRCD, config.tCAS, config.tRP};
+  }
+
+  /// the counters of DRAM, in the order a checkpoint stores them
+  template <typename D>
+  auto DramCounters(D &dram) {
+    return std::array{&dram.reads, &dram.writes, &dram.rowHits, &dram.rowMisses, &dram.rowConflicts,
+                      &dram.bankWaits, &dram.bankWaitCycles};
+  }
+
+  /// the counters of a store buffer, likewise
+  template <typename B>
+  auto StoreBufferCounters(B &buffer) {
+    return std::array{&buffer.stores, &buffer.fullStalls, &buffer.fullStallCycles, &buffer.forwards,
+                      &buffer.overlapStalls, &buffer.overlapStallCycles};
+  }
+
+  /// the counters of a cache, in the order a checkpoint stores them
+  template <typename C>
+  auto Counters(C &cache) {
+    return std::array{&cache.accesses, &cache.hits, &cache.misses, &cache.evictions, &cache.writebacks,
+                      &cache.prefetches, &cache.usefulPrefetches, &cache.latePrefetches, &cache.uselessPrefetches};
+  }
+
+  auto Reject(const char *reason) -> bool {
+    LOG("not a loadable checkpoint: %s\n", reason);
+    return false;
+  }
+}
+
+auto WriteCheckpoint(const Executor &executor) -> std::string {
+  Writer w;
+  CheckpointHeader header{};
+  std::memcpy(header.magic, CheckpointHeader::Magic, sizeof header.magic);
+  header.version = CheckpointHeader::CurrentVersion;
+  header.codeSize = CODE_SIZE;
+  w.put(header);
+
+  w.put(static_cast<u8>(executor.halted));
+  w.put(static_cast<u8>(executor.fuse));
+  w.put(executor.program.entry);
+  w.put(executor.instret);
+  w.put(executor.cycles);
+  w.put(executor.fusions);
+
+  w.put(executor.pc);
+  w.put(executor.RF);
+  w.put(executor.memCycles);
+  w.put(executor.stallSignal.stallPos);
+  w.put(executor.stallSignal.stallTimeCount);
+  w.put(static_cast<u8>(executor.stallSignal.insertBubble));
+  w.put(executor.killSignal.killPos);
+  for (const Executor::Latch *latch : {&executor.IF, &executor.ID, &executor.EX, &executor.MEM, &executor.WB, &executor.memInst})
+    w.latch(*latch);
+
+  const Predictor &predictor = executor.predictor;
+  w.put(predictor.hit);
+  w.put(predictor.total);
+  w.sparse(reinterpret_cast<const u8 *>(predictor.impl.counter), sizeof predictor.impl.counter);
+  w.sparse(predictor.impl.history, sizeof predictor.impl.history);
+
+  w.put(executor.fetchCycles);
+  w.put(executor.fetchPc);
+  for (const Cache *cache : {&executor.icache, &executor.dcache}) {
+    for (const u32 field : ConfigFields(cache->config))
+      w.put(field);
+    for (const u64 *count : Counters(*cache))
+      w.put(*count);
+    w.put(cache->seed);
+    w.sparse(reinterpret_cast<const u8 *>(cache->lines.data()), static_cast<u32>(cache->lines.size() * sizeof(Cache::Line)));
+    w.sparse(reinterpret_cast<const u8 *>(cache->plru.data()), static_cast<u32>(cache->plru.size() * sizeof(u32)));
+  }
+  const Prefetcher &prefetcher = executor.prefetcher;
+  for (const u32 field : PrefetcherFields(prefetcher.config))
+    w.put(field);
+  w.sparse(reinterpret_cast<const u8 *>(prefetcher.table.data()),
+    static_cast<u32>(prefetcher.table.size() * sizeof(Prefetcher::Entry)));
+  const Dram &dram = executor.dram;
+  for (const u32 field : DramFields(dram.config))
+    w.put(field);
+  for (const u64 *count : DramCounters(dram))
+    w.put(*count);
+  w.sparse(reinterpret_cast<const u8 *>(dram.banks.data()), static_cast<u32>(dram.banks.size() * sizeof(Dram::Bank)));
+  const StoreBuffer &buffer = executor.storeBuffer;
+  w.put(static_cast<u32>(buffer.entries.size()));
+  w.put(buffer.head);
+  w.put(buffer.count);
+  w.put(buffer.headDoneAt);
+  for (const u64 *count : StoreBufferCounters(buffer))
+    w.put(*count);
+  w.sparse(reinterpret_cast<const u8 *>(buffer.entries.data()),
+    static_cast<u32>(buffer.entries.size() * sizeof(StoreBuffer::Entry)));
+
+  w.put(static_cast<u32>(executor.program.symbols.size()));
+  for (const Symbol &symbol : executor.program.symbols) {
+    w.put(symbol.value);
+    w.put(symbol.size);
+    w.put(static_cast<u8>(symbol.function));
+    w.put(static_cast<u32>(symbol.name.size()));
+    w.out += symbol.name;
+  }
+
+  // memory is a sparse blob too, with guest addresses as offsets
+  const std::vector<SnapshotExtent> extents = NonzeroExtents(executor.mem);
+  w.put(static_cast<u32>(extents.size()));
+  w.out.append(reinterpret_cast<const char *>(extents.data()), extents.size() * sizeof(SnapshotExtent));
+  for (const SnapshotExtent &extent : extents) {
+    const std::size_t at = w.out.size();
+    w.out.resize(at + extent.size);
+    executor.mem.read(extent.address, w.out.data() + at, extent.size);
+  }
+
+  header.checksum = WordChecksum(w.out.data() + AfterChecksum, w.out.size() - AfterChecksum);
+  std::memcpy(w.out.data() + offsetof(CheckpointHeader, checksum), &header.checksum, sizeof header.checksum);
+  return std::move(w.out);
+}
+
+auto IsCheckpoint(const char *begin, const char *end) -> bool {
+  return end - begin >= static_cast<std::ptrdiff_t>(sizeof CheckpointHeader::Magic)
+    and std::memcmp(begin, CheckpointHeader::Magic, sizeof CheckpointHeader::Magic) == 0;
+}
+
+auto LoadCheckpoint(const char *begin, const char *end, Executor &executor) -> bool {
+  const std::size_t size = static_cast<std::size_t>(end - begin);
+  if (!IsCheckpoint(begin, end) or size < sizeof(CheckpointHeader))
+    return Reject("truncated header");
+  CheckpointHeader header;
+  std::memcpy(&header, begin, sizeof header);
+  if (header.version != CheckpointHeader::CurrentVersion)
+    return Reject("unknown version");
+  if (WordChecksum(begin + AfterChecksum, size - AfterChecksum) != header.checksum)
+    return Reject("checksum mismatch");
+  if (header.codeSize != CODE_SIZE)
+    return Reject("written with another CODE_SIZE");
+
+  // read everything before changing anything, so a bad checkpoint leaves the executor alone
+  Reader r{begin + sizeof header, end};
+  const bool halted = r.get<u8>() != 0;
+  const bool fuse = r.get<u8>() != 0;
+  const u32 entry = r.get<u32>();
+  const u64 instret = r.get<u64>();
+  const u64 cycles = r.get<u64>();
+  u64 fusions[NumFusedPairs];
+  r.take(fusions, sizeof fusions);
+
+  const Register pc = r.get<Register>();
+  const RegisterFile RF = r.get<RegisterFile>();
+  const u32 memCycles = r.get<u32>();
+  StallSignal stallSignal;
+  stallSignal.stallPos = r.get<u32>();
+  stallSignal.stallTimeCount = r.get<u32>();
+  stallSignal.insertBubble = r.get<u8>() != 0;
+  KillSignal killSignal;
+  killSignal.killPos = r.get<u32>();
+  Executor::Latch latches[6];
+  for (Executor::Latch &latch : latches)
+    latch = r.latch();
+  if (r.ok and (entry >= CODE_SIZE or u32(pc) >= CODE_SIZE))
+    return Reject("pc not below CODE_SIZE");
+
+  const u64 hit = r.get<u64>(), total = r.get<u64>();
+  const Reader::Sparse counters = r.sparse(sizeof executor.predictor.impl.counter);
+  const Reader::Sparse history = r.sparse(sizeof executor.predictor.impl.history);
+
+  const u32 fetchCycles = r.get<u32>();
+  const u32 fetchPc = r.get<u32>();
+  struct CacheState {
+    std::array<u64, 9> counts;
+    u32 seed;
+    Reader::Sparse lines, plru;
+  } caches[2];
+  const Cache *const targets[2] = {&executor.icache, &executor.dcache};
+  for (u32 i = 0; i < 2; ++i) {
+    bool same = true;
+    for (const u32 field : ConfigFields(targets[i]->config))
+      same &= r.get<u32>() == field;
+    if (r.ok and !same)
+      return Reject("written with other caches");
+    CacheState &state = caches[i];
+    for (u64 &count : state.counts)
+      count = r.get<u64>();
+    state.seed = r.get<u32>();
+    state.lines = r.sparse(targets[i]->lines.size() * sizeof(Cache::Line));
+    state.plru = r.sparse(targets[i]->plru.size() * sizeof(u32));
+  }
+  bool samePrefetcher = true;
+  for (const u32 field : PrefetcherFields(executor.prefetcher.config))
+    samePrefetcher &= r.get<u32>() == field;
+  if (r.ok and !samePrefetcher)
+    return Reject("written with another prefetcher");
+  const Reader::Sparse table = r.sparse(executor.prefetcher.table.size() * sizeof(Prefetcher::Entry));
+  bool sameDram = true;
+  for (const u32 field : DramFields(executor.dram.config))
+    sameDram &= r.get<u32>() == field;
+  if (r.ok and !sameDram)
+    return Reject("written with other DRAM");
+  std::array<u64, 7> dramCounts;
+  for (u64 &count : dramCounts)
+    count = r.get<u64>();
+  const Reader::Sparse banks = r.sparse(executor.dram.banks.size() * sizeof(Dram::Bank));
+  const std::size_t depth = executor.storeBuffer.entries.size();
+  const bool sameDepth = r.get<u32>() == depth;
+  if (r.ok and !sameDepth)
+    return Reject("written with another store buffer depth");
+  const u32 bufferHead = r.get<u32>(), bufferCount = r.get<u32>();
+  const u64 headDoneAt = r.get<u64>();
+  if (r.ok and (bufferCount > depth or (bufferHead >= depth and depth > 0)))
+    return Reject("malformed store buffer");
+  std::array<u64, 6> bufferCounts;
+  for (u64 &count : bufferCounts)
+    count = r.get<u64>();
+  const Reader::Sparse bufferEntries = r.sparse(depth * sizeof(StoreBuffer::Entry));
+
+  std::vector<Symbol> symbols;
+  for (u32 count = r.get<u32>(); r.ok and count > 0; --count) {
+    Symbol symbol{};
+    symbol.value = r.get<u32>();
+    symbol.size = r.get<u32>();
+    symbol.function = r.get<u8>() != 0;
+    const u32 length = r.get<u32>();
+    if (!r.ok or static_cast<std::size_t>(r.end - r.at) < length)
+      return Reject("truncated symbols");
+    symbol.name.assign(r.at, length);
+    r.at += length;
+    symbols.push_back(std::move(symbol));
+  }
+
+  const Reader::Sparse memory = r.sparse(1ull << 32);
+  if (!r.ok)
+    return Reject("truncated or malformed state");
+  if (r.at != end)
+    return Reject("trailing bytes");
+
+  executor.halted = halted;
+  executor.fuse = fuse;
+  executor.program = ProgramInfo{entry, std::move(symbols)};
+  executor.instret = instret;
+  executor.cycles = cycles;
+  std::copy(std::begin(fusions), std::end(fusions), executor.fusions);
+  executor.pc = pc;
+  executor.RF = RF;
+  executor.memCycles = memCycles;
+  executor.stallSignal = stallSignal;
+  executor.killSignal = killSignal;
+  executor.IF = latches[0], executor.ID = latches[1], executor.EX = latches[2];
+  executor.MEM = latches[3], executor.WB = latches[4], executor.memInst = latches[5];
+
+  Predictor &predictor = executor.predictor;
+  predictor.hit = hit;
+  predictor.total = total;
+  Unpack(counters, reinterpret_cast<u8 *>(predictor.impl.counter), sizeof predictor.impl.counter);
+  Unpack(history, predictor.impl.history, sizeof predictor.impl.history);
+
+  executor.fetchCycles = fetchCycles;
+  executor.fetchPc = fetchPc;
+  Cache *const restored[2] = {&executor.icache, &executor.dcache};
+  for (u32 i = 0; i < 2; ++i) {
+    Cache &cache = *restored[i];
+    const std::array<u64 *, 9> counts = Counters(cache);
+    for (u32 count = 0; count < counts.size(); ++count)
+      *counts[count] = caches[i].counts[count];
+    cache.seed = caches[i].seed;
+    Unpack(caches[i].lines, reinterpret_cast<u8 *>(cache.lines.data()), static_cast<u32>(cache.lines.size() * sizeof(Cache::Line)));
+    Unpack(caches[i].plru, reinterpret_cast<u8 *>(cache.plru.data()), static_cast<u32>(cache.plru.size() * sizeof(u32)));
+  }
+  Prefetcher &prefetcher = executor.prefetcher;
+  Unpack(table, reinterpret_cast<u8 *>(prefetcher.table.data()),
+    static_cast<u32>(prefetcher.table.size() * sizeof(Prefetcher::Entry)));
+  Dram &dram = executor.dram;
+  const std::array<u64 *, 7> dramCounters = DramCounters(dram);
+  for (u32 count = 0; count < dramCounters.size(); ++count)
+    *dramCounters[count] = dramCounts[count];
+  Unpack(banks, reinterpret_cast<u8 *>(dram.banks.data()), static_cast<u32>(dram.banks.size() * sizeof(Dram::Bank)));
+  StoreBuffer &buffer = executor.storeBuffer;
+  buffer.head = bufferHead;
+  buffer.count = bufferCount;
+  buffer.headDoneAt = headDoneAt;
+  const std::array<u64 *, 6> bufferCounters = StoreBufferCounters(buffer);
+  for (u32 count = 0; count < bufferCounters.size(); ++count)
+    *bufferCounters[count] = bufferCounts[count];
+  Unpack(bufferEntries, reinterpret_cast<u8 *>(buffer.entries.data()),
+    static_cast<u32>(buffer.entries.size() * sizeof(StoreBuffer::Entry)));
+
+  executor.mem.clear();
+  const char *bytes = memory.bytes;
+  for (const SnapshotExtent &extent : memory.extents) {
+    executor.mem.write(extent.address, bytes, extent.size);
+    bytes += extent.size;
+  }
+  executor.mem.notify(0, CODE_SIZE);
+  return true;
+}
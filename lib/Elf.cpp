@@ -0,0 +1,130 @@
+#include "Elf.hpp"
+#include "Memory.hpp"
+
+namespace {
+  // the parts of the ELF32 format the loader reads (see elf(5))
+  constexpr u8 ElfClass32 = 1;
+  constexpr u8 ElfDataLittleEndian = 1;
+  constexpr u16 ElfTypeExecutable = 2;
+  constexpr u16 ElfMachineRiscV = 243;
+  constexpr u32 ProgramLoad = 1;
+  constexpr u32 ProgramExecutable = 1;  // PF_X
+  constexpr u32 SectionSymbolTable = 2;
+  constexpr u8 SymbolTypeNone = 0, SymbolTypeObject = 1, SymbolTypeFunction = 2;
+
+  constexpr std::size_t HeaderSize = 52, ProgramHeaderSize = 32, SectionHeaderSize = 40, SymbolSize = 16;
+
+  /// a view of the file that fails, rather than reads past the end, on out
+  /// of range fields. Fields are little-endian, as is the host.
+  struct ElfFile {
+    const char *begin;
+    std::size_t size;
+
+    auto holds(const u64 offset, const u64 length) const -> bool {
+      return offset <= size and length <= size - offset;
+    }
+
+    template <typename T>
+    auto read(const u64 offset) const -> T {
+      T value;
+      std::memcpy(&value, begin + offset, sizeof value);
+      return value;
+    }
+  };
+
+  auto Reject(const char *reason) -> std::nullopt_t {
+    LOG("not a loadable ELF32 RISC-V executable: %s\n", reason);
+    return std::nullopt;
+  }
+
+  /// named function, object and untyped symbols of the first symbol table,
+  /// by address; none if the file has no section headers or was stripped
+  auto ReadSymbols(const ElfFile &file) -> std::vector<Symbol> {
+    std::vector<Symbol> symbols;
+    const u32 sectionOffset = file.read<u32>(32);
+    const u16 sectionEntrySize = file.read<u16>(46), sections = file.read<u16>(48);
+    if (sectionOffset == 0 or sectionEntrySize < SectionHeaderSize
+        or !file.holds(sectionOffset, (u64)sections * sectionEntrySize))
+      return symbols;
+
+    const auto section = [&](const u32 index) -> u64 { return sectionOffset + (u64)index * sectionEntrySize; };
+    for (u32 index = 0; index < sections; ++index) {
+      if (file.read<u32>(section(index) + 4) != SectionSymbolTable)
+        continue;
+      const u32 offset = file.read<u32>(section(index) + 16), size = file.read<u32>(section(index) + 20);
+      const u32 link = file.read<u32>(section(index) + 24);
+      if (link >= sections or !file.holds(offset, size))
+        break;
+      const u32 stringOffset = file.read<u32>(section(link) + 16), stringSize = file.read<u32>(section(link) + 20);
+      if (!file.holds(stringOffset, stringSize))
+        break;
+
+      for (u64 at = offset; at + SymbolSize <= (u64)offset + size; at += SymbolSize) {
+        const u32 name = file.read<u32>(at);
+        const u8 type = file.read<u8>(at + 12) & 0xf;
+        if (name == 0 or name >= stringSize
+            or (type != SymbolTypeNone and type != SymbolTypeObject and type != SymbolTypeFunction))
+          continue;
+        const char *text = file.begin + stringOffset + name;
+        const std::size_t length = strnlen(text, stringSize - name);
+        symbols.push_back(Symbol{std::string(text, length), file.read<u32>(at + 4), file.read<u32>(at + 8),
+                                 type == SymbolTypeFunction});
+      }
+      break;
+    }
+
+    std::stable_sort(symbols.begin(), symbols.end(),
+      [](const Symbol &a, const Symbol &b) { return a.value < b.value; });
+    return symbols;
+  }
+}
+
+auto ProgramInfo::symbolAt(const u32 address) const -> const Symbol * {
+  auto after = std::upper_bound(symbols.begin(), symbols.end(), address,
+    [](const u32 value, const Symbol &symbol) { return value < symbol.value; });
+  if (after == symbols.begin())
+    return nullptr;
+  const Symbol &symbol = *std::prev(after);
+  return symbol.size == 0 or address - symbol.value < symbol.size ? &symbol : nullptr;
+}
+
+auto IsElf(const char *begin, const char *end) -> bool {
+  return end - begin >= 4 and std::memcmp(begin, "\x7f" "ELF", 4) == 0;
+}
+
+auto LoadElf(const char *begin, const char *end, Memory &mem) -> std::optional<ProgramInfo> {
+  const ElfFile file{begin, static_cast<std::size_t>(end - begin)};
+  if (!IsElf(begin, end) or !file.holds(0, HeaderSize))
+    return Reject("truncated header");
+  if (file.read<u8>(4) != ElfClass32 or file.read<u8>(5) != ElfDataLittleEndian)
+    return Reject("not 32-bit little-endian");
+  if (file.read<u16>(16) != ElfTypeExecutable or file.read<u16>(18) != ElfMachineRiscV)
+    return Reject("not a RISC-V executable");
+
+  const u32 entry = file.read<u32>(24);
+  const u32 programOffset = file.read<u32>(28);
+  const u16 programEntrySize = file.read<u16>(42), programs = file.read<u16>(44);
+  if (programEntrySize < ProgramHeaderSize or !file.holds(programOffset, (u64)programs * programEntrySize))
+    return Reject("truncated program headers");
+  if (entry >= CODE_SIZE or entry % 4 != 0)
+    return Reject("entry point not below CODE_SIZE");
+
+  for (u32 index = 0; index < programs; ++index) {
+    const u64 header = programOffset + (u64)index * programEntrySize;
+    if (file.read<u32>(header) != ProgramLoad)
+      continue;
+    const u32 offset = file.read<u32>(header + 4), address = file.read<u32>(header + 8);
+    const u32 fileSize = file.read<u32>(header + 16), memorySize = file.read<u32>(header + 20);
+    if (fileSize > memorySize or !file.holds(offset, fileSize))
+      return Reject("truncated segment");
+    if ((u64)address + memorySize > (1ull << 32))
+      return Reject("segment past the end of the address space");
+    // code is only decoded and translated below CODE_SIZE
+    if ((file.read<u32>(header + 24) & ProgramExecutable) != 0 and (u64)address + memorySize > CODE_SIZE)
+      return Reject("executable segment not below CODE_SIZE");
+    // the rest of the segment, up to memorySize, is bss and stays zero
+    mem.write(address, begin + offset, fileSize);
+  }
+
+  return ProgramInfo{entry, ReadSymbols(file)};
+}
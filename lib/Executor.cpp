@@ -1,115 +1,171 @@
 #include "Executor.hpp"
+#include "HeapStats.hpp"
 
 auto Executor::InstFetch() -> void {
-  IF = std::make_shared<Instruction>(mem.load<u32>(pc), pc, RF);
-  pc = pc + 4;
+  fetch(pc);
+}
+
+auto Executor::fetch(const u32 at) -> void {
+  // the decode cache and the predictor are both indexed by pc
+  if constexpr (!NOASSERT)
+    assert(at < CODE_SIZE && "pc exceeds CODE_SIZE");
+  if constexpr (UseCaches) {
+    // a miss leaves IF empty, and pc at `at`, until its line arrives;
+    // a redirect abandons it, with the line filled all the same
+    if (fetchCycles == 0 or fetchPc != at) {
+      fetchCycles = icache.access(at, false, cycles).latency;
+      fetchPc = at;
+    }
+    if (--fetchCycles != 0) {
+      IF.reset();
+      pc = at;
+      return;
+    }
+  }
+  IF = MicroOp::Fetched(mem.load<u32>(at), at);
+  pc = at + 4;
 }
 
 auto Executor::InstDecode() -> void {
-  if (ID == nullptr)
+  if (!ID)
     return;
 
-  ID = Instruction::Decode(ID->encoding, Register(ID->pc), RF);
+  if constexpr (UseDecodeCache)
+    ID = decodeCache.decode(ID->encoding, ID->pc, RF);
+  else {
+    ID = MicroOp::Decode(ID->encoding, ID->pc);
+    ID->read(RF);
+  }
 
-  if (JAL::is(ID->encoding)) {
-    pc = ID->pc + ID->imm;
+  // an idiom spread over ID and IF leaves decode as one micro-op
+  if (fuse and IF and (ID->kind == InstTag::ID::LUI or ID->kind == InstTag::ID::AUIPC))
+    if (const auto fused = Fusion::Fuse(*ID, MicroOp::Decode(IF->encoding, IF->pc))) {
+      ID = fused;
+      ID->read(RF);
+      if constexpr (PipelineFusionTiming == FusionTiming::OneSlot) {
+        // fetch goes on past the tail in the same cycle, through the instruction cache
+        fetch(ID->pc + 4);
+      } else {
+        IF.reset();
+      }
+    }
+
+  if (ID->kind == InstTag::ID::JAL) {
+    pc = ID->target();
     killSignal.set<KillSignal::ID>();
     return;
   }
 
-  if (BranchCC_rri::is(ID->encoding)) {
-    auto inst = std::dynamic_pointer_cast<BranchCC_rri>(ID);
-
-    if (inst == nullptr and !NOASSERT)
-      assert(false);
-
-    inst->pred = predictor.predict(ID->pc);
-    if (inst->pred) {
-      pc = ID->pc + ID->imm;
+  if (InstTag::IsBranch(ID->kind)) {
+    ID->pred = predictor.predict(ID->pc);
+    if (ID->pred) {
+      pc = ID->target();
       killSignal.set<KillSignal::ID>();
     }
   }
 }
 
 auto Executor::InstExecute() -> void {
-  if (EX == nullptr)
+  if (!EX)
     return;
 
-  EX->Execute();
+  Execute(*EX);
 
-  if (JALR::is(EX->encoding)) {
-    auto inst = std::dynamic_pointer_cast<JALR>(EX);
-    if (inst == nullptr and !NOASSERT)
-      assert(false);
-    pc = std::get<0>(inst->fields);
+  if (EX->kind == InstTag::ID::JALR) {
+    pc = EX->indirectTarget();
     killSignal.set<KillSignal::EX>();
   }
 
-  if (BranchCC_rri::is(EX->encoding)) {
-    auto inst = std::dynamic_pointer_cast<BranchCC_rri>(EX);
-
-    if (inst == nullptr and !NOASSERT)
-      assert(false);
-
-    predictor.report(inst->pc, inst->cond);
-    if (inst->cond != inst->pred) {
-      pc = inst->cond ? inst->pcv : (inst->pc + 4);
+  if (InstTag::IsBranch(EX->kind)) {
+    predictor.report(EX->pc, EX->cond);
+    if (EX->cond != EX->pred) {
+      pc = EX->cond ? EX->target() : (EX->pc + 4);
       killSignal.set<KillSignal::EX>();
     }
   }
 }
 
 auto Executor::InstMemAccess() -> void {
-  static u32 Counter = 0; // simulate memory access with 3 clock cycles
-  static InstPtr inst = nullptr;
-
-  if (Counter == 0) {
-    if (MEM == nullptr)
+  if (memCycles == 0) {
+    if (!MEM)
       return;
-    if (!Load_ri::is(MEM->encoding) and !Store_rri::is(MEM->encoding))
+    if (!InstTag::IsLoad(MEM->kind) and !InstTag::IsStore(MEM->kind))
       return;
   }
 
-  if (Counter == 0) {
-    inst = MEM;
-    Counter = 3;
-    stallSignal.set<StallSignal::MEM>(3);
+  if (memCycles == 0) {
+    memInst = MEM;
+    const u32 address = MEM->address();
+    const bool store = InstTag::IsStore(MEM->kind);
+    if constexpr (StoreBufferDepth == 0)
+      memCycles = memoryLatency(MEM->pc, address, store, cycles);
+    else if (store)
+      // the stage's own cycle, after waiting for room in the buffer
+      memCycles = storeBuffer.push(MEM->pc, address, MEM->width(), cycles, dataPort()) + 1;
+    else
+      memCycles = storeBuffer.load(MEM->pc, address, MEM->width(), cycles, dataPort());
+    stallSignal.set<StallSignal::MEM>(memCycles);
   }
 
-  if (--Counter == 0) {
-    MEM = inst;
-    inst = nullptr;
-    MEM->MemAccess(mem);
+  if (--memCycles == 0) {
+    MEM = memInst;
+    memInst.reset();
+    MemAccess(*MEM, mem);
   } else {
-    MEM = nullptr;
+    MEM.reset();
   }
 }
 
+auto Executor::memoryLatency(const u32 instPc, const u32 address, const bool write, const u64 at) -> u32 {
+  if constexpr (UseCaches) {
+    const Cache::Access access = dcache.access(address, write, at);
+    prefetcher.observe(instPc, address, access, dcache, at);
+    return access.latency;
+  } else if constexpr (UseDram)
+    return static_cast<u32>(dram.access(address, write, at) - at) + 1;
+  else
+    return FlatMemoryLatency;
+}
+
 auto Executor::InstWriteBack() -> void {
-  if (WB == nullptr)
+  if (!WB)
     return;
 
-  WB->WriteBack(RF);
+  WriteBack(*WB, RF);
   RF.tick();
+  ++instret;
+  if (WB->fusion != FusedPair::None) {
+    ++fusions[static_cast<u32>(WB->fusion)];
+    ++instret;
+  }
 }
 
-auto Executor::exec(std::istream &input) -> u32 {
-  initMem(input);
-  pc = 0; pc.tick();
-  IF = ID = EX = MEM = WB = nullptr;
-  for (u64 clk = 0; ; ++clk) {
+auto Executor::runPipeline() -> u32 {
+  const u64 heapAllocationsBefore = HeapAllocations();
+  for (;; ++cycles) {
+    if (cycles == pauseAt or instret >= pauseRetired)
+      break;
+
     // forwarding
     if (ID and ID->rs1) {
-      if (EX and EX->rd == ID->rs1 and !Load_ri::is(EX->encoding))
+      if (EX and EX->rd == ID->rs1 and !InstTag::IsLoad(EX->kind))
         ID->rs1v = EX->rdv;
+      else if (EX and EX->headRd == ID->rs1)
+        ID->rs1v = EX->headValue();
       else if (MEM and MEM->rd == ID->rs1)
         ID->rs1v = MEM->rdv;
+      else if (MEM and MEM->headRd == ID->rs1)
+        ID->rs1v = MEM->headValue();
     }
     if (ID and ID->rs2) {
-      if (EX and EX->rd == ID->rs2 and !Load_ri::is(EX->encoding))
+      if (EX and EX->rd == ID->rs2 and !InstTag::IsLoad(EX->kind))
         ID->rs2v = EX->rdv;
+      else if (EX and EX->headRd == ID->rs2)
+        ID->rs2v = EX->headValue();
       else if (MEM and MEM->rd == ID->rs2)
         ID->rs2v = MEM->rdv;
+      else if (MEM and MEM->headRd == ID->rs2)
+        ID->rs2v = MEM->headValue();
     }
 
     // tick
@@ -119,7 +175,7 @@ auto Executor::exec(std::istream &input) -> u32 {
     if (!stallSignal.willStall<StallSignal::EX>()) {
       EX = ID;
     } else if (stallSignal.willInsertBubble())
-      EX = nullptr;
+      EX.reset();
     if (!stallSignal.willStall<StallSignal::ID>())
       ID = IF;
 
@@ -133,14 +189,14 @@ auto Executor::exec(std::istream &input) -> u32 {
     InstMemAccess();
 
     stallSignal.countDown();
-    if (stallSignal.noStall() and EX and Load_ri::is(EX->encoding))
+    if (stallSignal.noStall() and EX and InstTag::IsLoad(EX->kind))
       if (ID and EX->rd != 0 and (EX->rd == ID->rs1 or EX->rd == ID->rs2))
         stallSignal.set<StallSignal::MEM>(1, true);
 
     if (killSignal.willKill<KillSignal::IF>())
-      IF = nullptr;
+      IF.reset();
     if (killSignal.willKill<KillSignal::ID>())
-      ID = nullptr;
+      ID.reset();
     killSignal.reset();
 
     /* ----------------- Dump Options ----------------- */
@@ -149,7 +205,7 @@ auto Executor::exec(std::istream &input) -> u32 {
       assert(u32(RF[0]) == 0);
 
     if constexpr (DumpOptions::DumpInst or DumpOptions::DumpRegState)
-      LOG("clock cycle %llu\n", clk);
+      LOG("clock cycle %llu\n", cycles);
 
     if constexpr (DumpOptions::DumpInst) {
       LOG("IF  "); if (IF) IF->dump(); else putn(' ', 28), LOG("bubble\n");
@@ -166,21 +222,229 @@ auto Executor::exec(std::istream &input) -> u32 {
     }
 
     if constexpr (DumpOptions::ClkLimit > 0) {
-      if (clk >= DumpOptions::ClkLimit)
+      if (cycles >= DumpOptions::ClkLimit)
         break;
     }
 
-    if (MEM and MEM->encoding == 0x0ff00513u) {
+    if (MEM and MEM->encoding == HaltEncoding) {
+      halted = true;
       LOG("=========================== Execution Ends ===========================\n");
       if constexpr (DumpOptions::DumpTotalClockCycle)
-        LOG("execution time:       %llu clock cycles\n", clk);
+        LOG("execution time:       %llu clock cycles\n", cycles);
       if constexpr (DumpOptions::DumpPredictionAccuracy)
         LOG("prediction accuracy:  %.6lf%% (%llu hits / %llu predictions in total)\n",
           predictor.hitRate() * 100.0, predictor.hit, predictor.total);
+      if constexpr (DumpOptions::DumpCacheStats and UseCaches)
+        dumpCacheStats();
+      if constexpr (DumpOptions::DumpDramStats and UseDram)
+        dumpDramStats();
+      if constexpr (DumpOptions::DumpStoreBufferStats and StoreBufferDepth > 0)
+        dumpStoreBufferStats();
+      if constexpr (DumpOptions::DumpDecodeCacheStats)
+        LOG("decode cache:         %.6lf%% (%llu hits / %llu misses, %llu invalidations)\n",
+          decodeCache.hitRate() * 100.0, decodeCache.hits, decodeCache.misses, decodeCache.invalidations);
+      if constexpr (DumpOptions::DumpAllocStats)
+        LOG("heap allocations:     %llu during simulation\n", HeapAllocations() - heapAllocationsBefore);
+      if constexpr (DumpOptions::DumpFusionStats)
+        dumpFusionStats();
       break;
     }
   }
-  if constexpr (DumpOptions::DumpRetValue)
-    LOG("return value: %d\n", RF[10] & 255u);
   return RF[10] & 255u;
 }
+
+auto Executor::runFunctional() -> u32 {
+  u32 npc = pc;
+  for (;; ++instret) {
+    if (instret >= pauseAt)
+      break;
+
+    MicroOp *inst = fuse ? decodeCache.fetchFused(mem, npc) : decodeCache.fetch(mem, npc);
+
+    if (inst->encoding == HaltEncoding) {
+      halted = true;
+      dumpFunctionalStats();
+      break;
+    }
+
+    if (inst->fusion != FusedPair::None) {
+      npc = RetireFused(*inst, RF, mem);
+      ++fusions[static_cast<u32>(inst->fusion)];
+      ++instret;
+    } else {
+      inst->read(RF);
+      Execute(*inst);
+
+      // only loads and stores touch memory and only instructions with a
+      // destination write back
+      const u32 cur = npc;
+      npc = cur + 4;
+      switch (GetOpcode(inst->encoding)) {
+      case InstTag::OPC_LOAD:
+        MemAccess(*inst, mem);
+        RF.writeThrough(inst->rd, inst->rdv);
+        break;
+      case InstTag::OPC_STORE:
+        MemAccess(*inst, mem);
+        break;
+      case InstTag::OPC_BRANCH:
+        if (inst->cond)
+          npc = cur + inst->imm;
+        break;
+      case InstTag::OPC_JAL:
+        RF.writeThrough(inst->rd, inst->rdv);
+        npc = cur + inst->imm;
+        break;
+      case InstTag::OPC_JALR:
+        RF.writeThrough(inst->rd, inst->rdv);
+        npc = inst->indirectTarget();
+        break;
+      case InstTag::OPC_OP_IMM:
+      case InstTag::OPC_OP:
+      case InstTag::OPC_LUI:
+      case InstTag::OPC_AUIPC:
+        RF.writeThrough(inst->rd, inst->rdv);
+        break;
+      }
+    }
+
+    /* ----------------- Dump Options ----------------- */
+
+    if constexpr (DumpOptions::DumpInst)
+      inst->dump();
+
+    if constexpr (DumpOptions::DumpRegState) {
+      RF.dump();
+      LOG("\n\n");
+    }
+
+    if constexpr (DumpOptions::ClkLimit > 0) {
+      if (instret >= DumpOptions::ClkLimit)
+        break;
+    }
+  }
+  pc = npc; pc.tick();
+  return RF[10] & 255u;
+}
+
+auto Executor::dumpFunctionalStats() -> void {
+  LOG("=========================== Execution Ends ===========================\n");
+  if constexpr (DumpOptions::DumpTotalClockCycle)
+    LOG("execution time:       %llu instructions\n", instret);
+  if constexpr (DumpOptions::DumpDecodeCacheStats)
+    LOG("decode cache:         %.6lf%% (%llu hits / %llu misses, %llu invalidations)\n",
+      decodeCache.hitRate() * 100.0, decodeCache.hits, decodeCache.misses, decodeCache.invalidations);
+  if constexpr (DumpOptions::DumpBlockCacheStats)
+    LOG("block cache:          %llu translations, %llu flushes, %llu chained / %llu dispatched transitions\n",
+      blockCache.translations, blockCache.flushes, blockCache.chained, blockCache.dispatched);
+  if constexpr (DumpOptions::DumpFusionStats)
+    dumpFusionStats();
+}
+
+auto Executor::dumpCacheStats() -> void {
+  for (const auto &[name, cache] : {std::pair{"L1 I-cache:", &icache}, std::pair{"L1 D-cache:", &dcache}})
+    LOG("%-22s%.6lf%% (%llu hits / %llu misses, %llu evictions, %llu write-backs)\n", name,
+      cache->hitRate() * 100.0, cache->hits, cache->misses, cache->evictions, cache->writebacks);
+  if (prefetcher.config.policy == PrefetchPolicy::None)
+    return;
+  // accuracy: prefetched lines used; coverage: misses they removed; timely: used after they arrived
+  const f64 issued = (f64)dcache.prefetches, useful = (f64)dcache.usefulPrefetches;
+  LOG("L1 D-prefetch:        %llu issued, %.2lf%% accurate, %.2lf%% coverage, %.2lf%% timely, %llu evicted unused\n",
+    dcache.prefetches, issued == 0 ? 0.0 : 100.0 * useful / issued,
+    useful == 0 ? 0.0 : 100.0 * useful / (useful + (f64)dcache.misses),
+    useful == 0 ? 0.0 : 100.0 * (useful - (f64)dcache.latePrefetches) / useful, dcache.uselessPrefetches);
+}
+
+auto Executor::dumpDramStats() -> void {
+  const f64 accesses = (f64)dram.accesses();
+  const auto share = [accesses](const u64 count) { return accesses == 0 ? 0.0 : 100.0 * (f64)count / accesses; };
+  LOG("DRAM:                 %llu reads / %llu writes, %.2lf%% row hits, %.2lf%% row misses, %.2lf%% row conflicts\n",
+    dram.reads, dram.writes, share(dram.rowHits), share(dram.rowMisses), share(dram.rowConflicts));
+  LOG("DRAM banks:           %llu requests waited on a busy bank, %.2lf cycles each\n", dram.bankWaits,
+    dram.bankWaits == 0 ? 0.0 : (f64)dram.bankWaitCycles / (f64)dram.bankWaits);
+}
+
+auto Executor::dumpStoreBufferStats() -> void {
+  LOG("store buffer:         %llu stores, %llu stalled on a full buffer (%llu cycles), %llu loads forwarded, "
+    "%llu waited on a partial overlap (%llu cycles)\n", storeBuffer.stores, storeBuffer.fullStalls,
+    storeBuffer.fullStallCycles, storeBuffer.forwards, storeBuffer.overlapStalls, storeBuffer.overlapStallCycles);
+}
+
+auto Executor::dumpFusionStats() -> void {
+  if (!fuse)
+    return;
+  u64 fused = 0;
+  for (u32 pair = 1; pair < NumFusedPairs; ++pair)
+    fused += fusions[pair];
+  LOG("fused pairs:          %llu (covering %.2lf%% of %llu instructions retired)", fused,
+    instret == 0 ? 0.0 : 200.0 * (f64)fused / (f64)instret, instret);
+  for (u32 pair = 1; pair < NumFusedPairs; ++pair)
+    LOG(", %llu %s", fusions[pair], Fusion::Names[pair]);
+  LOG("\n");
+}
+
+auto Executor::run(const Engine engine) -> u32 {
+  if (restored) {
+    restored = false;
+    return resume(engine);
+  }
+  pc = program.entry; pc.tick();
+  IF = ID = EX = MEM = WB = memInst = std::nullopt;
+  memCycles = fetchCycles = 0;
+  stallSignal = StallSignal{};
+  killSignal = KillSignal{};
+  // the caches and memory stay warm from a previous run, but idle
+  storeBuffer.settle(~0ull, dataPort());
+  icache.settle(), dcache.settle(), dram.settle();
+  instret = cycles = 0;
+  std::fill(std::begin(fusions), std::end(fusions), 0);
+  return resume(engine);
+}
+
+auto Executor::resume(const Engine engine) -> u32 {
+  if constexpr (!NOASSERT)
+    assert((engine == Engine::Pipeline or !inFlight()) && "only the pipeline resumes with instructions in flight");
+  u32 ret = 0;
+  halted = false;
+  mem.fault.reset();
+  const bool finished = TrapGuestFaults([&] {
+    switch (engine) {
+    case Engine::Pipeline:   ret = runPipeline();   break;
+    case Engine::Functional: ret = runFunctional(); break;
+    case Engine::Threaded:   ret = runThreaded();   break;
+    case Engine::Block:      ret = runBlocks();     break;
+    case Engine::Jit:        ret = runJit();        break;
+    }
+  });
+  if (!finished) {
+    LogGuestFault(*mem.fault);
+    return 0;
+  }
+  if constexpr (DumpOptions::DumpRetValue)
+    LOG("return value: %d\n", ret);
+  return ret;
+}
+
+auto Executor::squash() -> void {
+  // the oldest comes first; the instruction in WB has retired. One in MEM may
+  // have made its access, which running it again repeats with the same operands
+  const Latch *oldest = nullptr;
+  for (const Latch *latch : {&memInst, &MEM, &EX, &ID, &IF})
+    if (*latch) {
+      oldest = latch;
+      break;
+    }
+  // with nothing in flight, the next fetch is the one pc is about to latch
+  if (oldest != nullptr)
+    pc = (*oldest)->pc;
+  pc.tick();
+  IF = ID = EX = MEM = WB = memInst = std::nullopt;
+  memCycles = fetchCycles = 0;
+  stallSignal = StallSignal{};
+  killSignal = KillSignal{};
+}
+
+auto Executor::exec(std::istream &input, const Engine engine) -> u32 {
+  initMem(input);
+  return run(engine);
+}
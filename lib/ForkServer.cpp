@@ -0,0 +1,104 @@
+#include "ForkServer.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+
+namespace {
+  /// what the clone writes back through the pipe
+  struct Report {
+    u32 faulted;
+    u32 ret;
+    u64 instret;
+    u64 cycles;
+  };
+}
+
+auto ForkServer::Warm(Executor &executor, const Engine engine) -> bool {
+  if (executor.pauseAt == ~0ull)
+    return true;
+  executor.run(engine);
+  if (executor.mem.fault or executor.halted) {
+    LOG("the program %s before the warm-up pause\n", executor.halted ? "halted" : "faulted");
+    return false;
+  }
+  return true;
+}
+
+auto ForkServer::run(const std::vector<InputPatch> &patches) const -> ServedRun {
+  ServedRun result{false, false, 0, 0, 0, 0};
+  const auto start = std::chrono::steady_clock::now();
+
+  i32 channel[2];
+  if (pipe(channel) != 0)
+    return result;
+  // anything buffered would be written again by the clone
+  fflush(stdout);
+  fflush(stderr);
+  const pid_t child = fork();
+  if (child < 0) {
+    close(channel[0]);
+    close(channel[1]);
+    return result;
+  }
+
+  if (child == 0) {
+    close(channel[0]);
+    // host writes, which wrap around the top of memory rather than fault
+    for (const InputPatch &patch : patches) {
+      warm.mem.write(patch.address, &patch.value, sizeof patch.value);
+      warm.mem.notify(patch.address, sizeof patch.value);
+    }
+    u32 ret;
+    if (warm.pauseAt != ~0ull) {
+      warm.pauseAt = ~0ull;
+      ret = warm.resume(engine);
+    } else
+      ret = warm.run(engine);
+    const Report report{warm.mem.fault.has_value(), ret, warm.instret, warm.cycles};
+    const bool sent = write(channel[1], &report, sizeof report) == sizeof report;
+    // skip the destructors and exit handlers, which belong to the server
+    _exit(sent ? 0 : 1);
+  }
+
+  close(channel[1]);
+  Report report{};
+  ssize_t got;
+  do
+    got = read(channel[0], &report, sizeof report);
+  while (got < 0 and errno == EINTR);
+  close(channel[0]);
+  i32 status = 0;
+  while (waitpid(child, &status, 0) < 0 and errno == EINTR)
+    ;
+
+  result.completed = got == sizeof report and WIFEXITED(status) and WEXITSTATUS(status) == 0;
+  if (result.completed) {
+    result.faulted = report.faulted != 0;
+    result.ret = report.ret;
+    result.instret = report.instret;
+    result.cycles = report.cycles;
+  }
+  result.ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+auto ParsePatches(const std::string &line) -> std::optional<std::vector<InputPatch>> {
+  std::vector<InputPatch> patches;
+  std::istringstream words(line);
+  for (std::string word; words >> word;) {
+    const std::size_t equals = word.find('=');
+    char *addressEnd = nullptr, *valueEnd = nullptr;
+    const unsigned long address = equals == std::string::npos ? 0 : std::strtoul(word.c_str(), &addressEnd, 0);
+    const unsigned long value = equals == std::string::npos ? 0 : std::strtoul(word.c_str() + equals + 1, &valueEnd, 0);
+    if (equals == std::string::npos or addressEnd != word.c_str() + equals or equals == 0
+        or valueEnd == word.c_str() + equals + 1 or *valueEnd != '\0' or address > 0xffffffffUL or value > 0xffffffffUL) {
+      LOG("bad patch '%s': expected address=value\n", word.c_str());
+      return std::nullopt;
+    }
+    patches.push_back(InputPatch{static_cast<u32>(address), static_cast<u32>(value)});
+  }
+  return patches;
+}
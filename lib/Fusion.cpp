@@ -0,0 +1,36 @@
+#include "Fusion.hpp"
+
+using InstTag::ID;
+
+auto Fusion::Fuse(const MicroOp &head, const MicroOp &tail) -> std::optional<MicroOp> {
+  if (head.rd == 0 or tail.rs1 != head.rd or tail.pc != head.pc + 4)
+    return std::nullopt;
+
+  FusedPair pair = FusedPair::None;
+  if (head.kind == ID::LUI) {
+    if (tail.kind == ID::ADDI)
+      pair = FusedPair::LuiAddi;
+    else if (InstTag::IsLoad(tail.kind))
+      pair = FusedPair::LuiLoad;
+    // the stored value would be read before the head writes it in the pipeline
+    else if (InstTag::IsStore(tail.kind) and tail.rs2 != head.rd)
+      pair = FusedPair::LuiStore;
+  } else if (head.kind == ID::AUIPC and tail.kind == ID::JALR) {
+    pair = FusedPair::AuipcJalr;
+  }
+  if (pair == FusedPair::None)
+    return std::nullopt;
+
+  MicroOp op = tail;
+  op.encoding = head.encoding;
+  op.fusion = pair;
+  op.rs1 = 0;
+  op.headRd = InstTag::WritesRd(tail.kind) and tail.rd == head.rd ? 0 : head.rd;
+  if (pair == FusedPair::AuipcJalr) {
+    op.kind = ID::JAL;
+    op.imm = ((head.pc + head.imm + tail.imm) & ~1u) - tail.pc;
+  } else {
+    op.imm = head.imm + tail.imm;
+  }
+  return op;
+}
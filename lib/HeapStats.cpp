@@ -0,0 +1,32 @@
+#include "HeapStats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//===----------------------------------------------------------------------===//
+// Heap allocation accounting
+//===----------------------------------------------------------------------===//
+
+namespace {
+  std::atomic<u64> heapAllocations{0};
+}
+
+auto HeapAllocations() -> u64 {
+  return heapAllocations.load(std::memory_order_relaxed);
+}
+
+auto operator new(std::size_t size) -> void * {
+  heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+auto operator delete(void *ptr) noexcept -> void {
+  std::free(ptr);
+}
+
+auto operator delete(void *ptr, std::size_t) noexcept -> void {
+  std::free(ptr);
+}
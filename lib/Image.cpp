@@ -0,0 +1,216 @@
+#include "Image.hpp"
+#include "Memory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  #include <immintrin.h>
+  #define IMAGE_SSSE3 1  // 16 hex bytes per step, if the host supports it
+#else
+  #define IMAGE_SSSE3 0
+#endif
+
+//===----------------------------------------------------------------------===//
+// Image text
+//===----------------------------------------------------------------------===//
+
+ImageText::~ImageText() { release(); }
+
+ImageText::ImageText(ImageText &&other) noexcept: ImageText() { *this = std::move(other); }
+
+auto ImageText::operator= (ImageText &&other) noexcept -> ImageText& {
+  if (this == &other)
+    return *this;
+  release();
+  mapping = std::exchange(other.mapping, nullptr);
+  mappedSize = std::exchange(other.mappedSize, 0);
+  // moving a short string copies its characters, so point into our own copy
+  const bool buffered = other.begin == other.buffer.data();
+  buffer = std::move(other.buffer);
+  begin = buffered ? buffer.data() : other.begin;
+  end = buffered ? buffer.data() + buffer.size() : other.end;
+  other.begin = other.end = nullptr;
+  return *this;
+}
+
+auto ImageText::release() -> void {
+  if (mapping != nullptr)
+    munmap(mapping, mappedSize);
+  mapping = nullptr;
+  mappedSize = 0;
+}
+
+auto ImageText::open(const char *path) -> std::optional<ImageText> {
+  const i32 fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return std::nullopt;
+  ImageText text = fromFd(fd);
+  close(fd);
+  return text;
+}
+
+auto ImageText::fromFd(const i32 fd) -> ImageText {
+  ImageText text;
+  struct stat status {};
+  if (fstat(fd, &status) == 0 and S_ISREG(status.st_mode) and status.st_size > 0) {
+    const auto size = static_cast<std::size_t>(status.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      text.mapping = mapping;
+      text.mappedSize = size;
+      text.begin = static_cast<const char *>(mapping);
+      text.end = text.begin + size;
+      return text;
+    }
+  }
+
+  char chunk[1 << 16];
+  for (ssize_t got; (got = read(fd, chunk, sizeof chunk)) > 0;)
+    text.buffer.append(chunk, static_cast<std::size_t>(got));
+  text.begin = text.buffer.data();
+  text.end = text.begin + text.buffer.size();
+  return text;
+}
+
+auto ImageText::fromStream(std::istream &input) -> ImageText {
+  ImageText text;
+  char chunk[1 << 16];
+  while (input.read(chunk, sizeof chunk) or input.gcount() > 0)
+    text.buffer.append(chunk, static_cast<std::size_t>(input.gcount()));
+  text.begin = text.buffer.data();
+  text.end = text.begin + text.buffer.size();
+  return text;
+}
+
+//===----------------------------------------------------------------------===//
+// Parsing
+//===----------------------------------------------------------------------===//
+
+namespace {
+  constexpr auto HexValue(const char c) -> i32 {
+    if (c >= '0' and c <= '9') return c - '0';
+    if (c >= 'a' and c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' and c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  constexpr auto IsSpace(const char c) -> bool {
+    return c == ' ' or c == '\n' or c == '\r' or c == '\t';
+  }
+
+#if IMAGE_SSSE3
+  /// pshufb controls picking bytes 3 * i + offset, i < 16, out of 48 bytes
+  /// held in three registers: one control per register, 0x80 elsewhere
+  struct Stride3Shuffle {
+    alignas(16) i8 from[3][16];
+  };
+
+  constexpr auto Stride3Controls(const i32 offset) -> Stride3Shuffle {
+    Stride3Shuffle shuffle{};
+    for (i32 i = 0; i < 16; ++i)
+      for (i32 reg = 0; reg < 3; ++reg) {
+        const i32 at = 3 * i + offset - 16 * reg;
+        shuffle.from[reg][i] = static_cast<i8>(at >= 0 and at < 16 ? at : 0x80);
+      }
+    return shuffle;
+  }
+
+  inline constexpr Stride3Shuffle Stride3Shuffles[3] = { Stride3Controls(0), Stride3Controls(1), Stride3Controls(2) };
+
+  /// lane i of the result takes byte 3 * i + offset of the 48 bytes in a, b, c
+  __attribute__((target("ssse3")))
+  inline auto Stride3(const __m128i a, const __m128i b, const __m128i c, const i32 offset) -> __m128i {
+    const auto control = [&](const i32 reg) {
+      return _mm_load_si128(reinterpret_cast<const __m128i *>(Stride3Shuffles[offset].from[reg]));
+    };
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, control(0)), _mm_shuffle_epi8(b, control(1))),
+                        _mm_shuffle_epi8(c, control(2)));
+  }
+
+  /// nibble value of 16 hex digits; `valid` gets 0xff in the lanes that are one
+  __attribute__((target("ssse3")))
+  inline auto Nibbles(const __m128i chars, __m128i &valid) -> __m128i {
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_andnot_si128(isDigit, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+  }
+
+  /// convert 48 characters laid out as 16 "hh " tokens (any whitespace as the
+  /// separator) into 16 bytes at `out`. false, with `out` untouched, if the
+  /// characters are laid out any other way.
+  __attribute__((target("ssse3")))
+  auto Convert16(const char *text, u8 *out) -> bool {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + 16));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + 32));
+
+    __m128i valid = _mm_set1_epi8(-1);
+    const __m128i high = Nibbles(Stride3(a, b, c, 0), valid);
+    const __m128i low = Nibbles(Stride3(a, b, c, 1), valid);
+    const __m128i separator = Stride3(a, b, c, 2);
+    valid = _mm_and_si128(valid, _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(separator, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(separator, _mm_set1_epi8('\n'))),
+      _mm_or_si128(_mm_cmpeq_epi8(separator, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(separator, _mm_set1_epi8('\t')))));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+      return false;
+
+    // nibbles are below 16, so shifting 16-bit lanes keeps every byte to itself
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_or_si128(_mm_slli_epi16(high, 4), low));
+    return true;
+  }
+
+  const bool HasSSSE3 = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+#endif
+}
+
+auto ParseImage(const char *begin, const char *end, Memory &mem) -> void {
+  const char *p = begin;
+  u32 pos = 0;
+  while (p != end) {
+    if (IsSpace(*p)) {
+      ++p;
+      continue;
+    }
+
+    if (*p == '@') {
+      u32 address = 0;
+      for (++p; p != end and HexValue(*p) >= 0; ++p)
+        address = (address << 4) | static_cast<u32>(HexValue(*p));
+      pos = address;
+      continue;
+    }
+
+#if IMAGE_SSSE3
+    if (HasSSSE3)
+      while (end - p >= 48 and (pos & Memory::PageMask) <= Memory::PageSize - 16
+             and Convert16(p, mem.page(pos) + (pos & Memory::PageMask))) {
+        p += 48;
+        pos += 16;
+      }
+    if (p == end or IsSpace(*p) or *p == '@')
+      continue;
+#endif
+
+    // a token of any length keeps its low byte, as `std::hex >> u32` would
+    u32 value = 0;
+    const char *token = p;
+    for (; p != end and HexValue(*p) >= 0; ++p)
+      value = (value << 4) | static_cast<u32>(HexValue(*p));
+    if (p == token) {
+      LOG("unexpected character '%c' in image at offset %zu\n", *p, static_cast<std::size_t>(p - begin));
+      ++p;
+      continue;
+    }
+    mem.page(pos)[pos & Memory::PageMask] = static_cast<u8>(value);
+    ++pos;
+  }
+}
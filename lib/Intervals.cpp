@@ -0,0 +1,128 @@
+#include "Intervals.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  /// checkpoints of the intervals, in order, as the functional pass writes them
+  struct Checkpoints {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::vector<std::string> states;  // emptied once a worker takes them
+    std::size_t next = 0;
+    bool done = false;
+
+    auto push(std::string state) -> void {
+      {
+        const std::lock_guard<std::mutex> hold(lock);
+        states.push_back(std::move(state));
+      }
+      ready.notify_one();
+    }
+
+    auto finish() -> void {
+      {
+        const std::lock_guard<std::mutex> hold(lock);
+        done = true;
+      }
+      ready.notify_all();
+    }
+
+    /// the next interval and its checkpoint; false once there are no more
+    auto take(std::size_t &interval, std::string &state) -> bool {
+      std::unique_lock<std::mutex> hold(lock);
+      ready.wait(hold, [&] { return next < states.size() or done; });
+      if (next == states.size())
+        return false;
+      interval = next++;
+      state = std::move(states[interval]);
+      return true;
+    }
+  };
+
+  /// what the workers measured, summed over their intervals
+  struct Totals {
+    u64 cycles = 0, hits = 0, predictions = 0, intervals = 0;
+    bool faulted = false;
+  };
+
+  /// time [start, end) through the pipeline of `worker`, from `state`,
+  /// which was taken at or before start
+  auto Measure(Executor &worker, const std::string &state, const u64 start, const u64 end, Totals &totals) -> void {
+    if (!LoadCheckpoint(state.data(), state.data() + state.size(), worker)) {
+      totals.faulted = true;
+      return;
+    }
+    worker.restored = true;
+    worker.pauseAt = ~0ull;
+    worker.pauseRetired = start;
+    worker.run(Engine::Pipeline);
+    totals.faulted |= worker.mem.fault.has_value();
+    // the program ended during the warm-up; the interval before ran to the end
+    if (worker.halted or worker.mem.fault)
+      return;
+
+    ++totals.intervals;
+    const u64 cycles = worker.cycles, hits = worker.predictor.hit, predictions = worker.predictor.total;
+    worker.pauseRetired = end;
+    worker.resume(Engine::Pipeline);
+    totals.faulted |= worker.mem.fault.has_value();
+    totals.cycles += worker.cycles - cycles;
+    totals.hits += worker.predictor.hit - hits;
+    totals.predictions += worker.predictor.total - predictions;
+  }
+}
+
+auto RunIntervals(Executor &executor, const IntervalOptions &options) -> IntervalRun {
+  const u64 length = std::max(options.length, 1ull);
+  const u64 warmup = std::min(options.warmup, length - 1);
+  // a checkpoint taken inside the pipeline goes on from its oldest instruction
+  if (executor.restored and executor.inFlight())
+    executor.squash();
+  const u64 base = executor.restored ? executor.instret : 0;
+  const u64 baseCycles = executor.restored ? executor.cycles : 0;
+
+  Checkpoints checkpoints;
+  std::vector<Totals> totals(std::max(options.jobs, 1u));
+  std::vector<std::thread> pool;
+  pool.reserve(totals.size());
+  for (Totals &mine : totals)
+    pool.emplace_back([&checkpoints, &mine, base, length] {
+      // an Executor is too large for a worker's stack
+      auto worker = std::make_unique<Executor>();
+      std::size_t interval;
+      for (std::string state; checkpoints.take(interval, state);)
+        Measure(*worker, state, base + interval * length, base + (interval + 1) * length, mine);
+    });
+
+  // the functional pass: interval k > 0 is checkpointed `warmup` instructions before it starts
+  IntervalRun result{};
+  executor.pauseAt = base;
+  u32 ret = executor.run(Engine::Functional);
+  for (u64 interval = 1; !executor.halted and !executor.mem.fault; ++interval) {
+    std::string state = WriteCheckpoint(executor);
+    result.checkpointBytes += state.size();
+    checkpoints.push(std::move(state));
+    executor.pauseAt = base + interval * length - warmup;
+    ret = executor.resume(Engine::Functional);
+  }
+  executor.pauseAt = ~0ull;
+  checkpoints.finish();
+  for (std::thread &worker : pool)
+    worker.join();
+
+  result.faulted = executor.mem.fault.has_value();
+  result.ret = result.faulted ? 0 : ret;
+  result.instret = executor.instret;
+  result.cycles = baseCycles;
+  for (const Totals &mine : totals) {
+    result.faulted |= mine.faulted;
+    result.cycles += mine.cycles;
+    result.hits += mine.hits;
+    result.predictions += mine.predictions;
+    result.intervals += mine.intervals;
+  }
+  return result;
+}
@@ -0,0 +1,406 @@
+#include "Executor.hpp"
+#include "Jit.hpp"
+
+#include <cstddef>
+
+#if JIT_X86_64
+  #include <sys/mman.h>
+#endif
+
+//===----------------------------------------------------------------------===//
+// Executable memory
+//===----------------------------------------------------------------------===//
+
+JitCodeBuffer::JitCodeBuffer(): base(nullptr), used(0) {
+#if JIT_X86_64
+  void *ptr = mmap(nullptr, Capacity, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr != MAP_FAILED)
+    base = static_cast<u8 *>(ptr);
+#endif
+}
+
+JitCodeBuffer::~JitCodeBuffer() {
+#if JIT_X86_64
+  if (base)
+    munmap(base, Capacity);
+#endif
+}
+
+auto JitCodeBuffer::install(const std::vector<u8> &code) -> Block::NativeCode {
+  if (base == nullptr or used + code.size() > Capacity)
+    return nullptr;
+  u8 *entry = base + used;
+  std::memcpy(entry, code.data(), code.size());
+  used = (used + code.size() + 15) & ~u64(15);
+  return reinterpret_cast<Block::NativeCode>(entry);
+}
+
+//===----------------------------------------------------------------------===//
+// x86-64 code generation
+//===----------------------------------------------------------------------===//
+//
+// register assignment inside a compiled block:
+//   rbx  JitContext *      r12  guest memory base      r13  translated-word map
+//   eax, ecx, edx          scratch; eax holds the next pc on return
+//
+// guest registers are loaded from and stored to JitContext::x around every
+// instruction, so a block can be left after any instruction.
+
+namespace {
+  constexpr u32 RegOffset(const u32 reg) { return offsetof(JitContext, x) + 4 * reg; }
+
+  // condition codes, as used in Jcc / SETcc / CMOVcc
+  enum Cond: u8 { Below = 0x2, AboveEqual = 0x3, Equal = 0x4, NotEqual = 0x5, Less = 0xC, GreaterEqual = 0xD };
+
+  struct Emitter {
+    std::vector<u8> code;
+
+    auto byte(const u32 value) -> void { code.push_back(static_cast<u8>(value)); }
+    auto bytes(std::initializer_list<u32> values) -> void { for (const u32 value : values) byte(value); }
+    auto dword(const u32 value) -> void { for (u32 i = 0; i < 32; i += 8) byte(value >> i); }
+
+    // op r32, [rbx + disp32]   (modrm reg field selects eax / ecx / edx)
+    auto ctxOp(const u32 opcode, const u32 reg, const u32 disp) -> void {
+      byte(opcode);
+      byte(0x80 | (reg << 3) | 0x3);
+      dword(disp);
+    }
+
+    auto loadReg(const u32 reg, const u32 guest) -> void {     // mov r32, x[guest]
+      ctxOp(0x8B, reg, RegOffset(guest));
+    }
+    auto storeReg(const u32 guest, const u32 reg) -> void {    // mov x[guest], r32
+      if (guest != 0)
+        ctxOp(0x89, reg, RegOffset(guest));
+    }
+    auto storeImm(const u32 guest, const u32 imm) -> void {    // mov x[guest], imm32
+      if (guest != 0) {
+        ctxOp(0xC7, 0, RegOffset(guest));
+        dword(imm);
+      }
+    }
+    auto movImm(const u32 reg, const u32 imm) -> void {        // mov r32, imm32
+      byte(0xB8 + reg);
+      dword(imm);
+    }
+    auto aluImm(const u32 ext, const u32 imm) -> void {        // add/or/and/sub/xor/cmp eax, imm32
+      byte(0x05 + (ext << 3));
+      dword(imm);
+    }
+    auto aluReg(const u32 opcode, const u32 guest) -> void {   // op eax, x[guest]
+      ctxOp(opcode, 0, RegOffset(guest));
+    }
+    auto shiftImm(const u32 ext, const u32 amount) -> void {   // shl/shr/sar eax, imm8
+      bytes({0xC1, 0xC0 | (ext << 3), amount & 31u});
+    }
+    auto shiftCl(const u32 ext) -> void {                      // shl/shr/sar eax, cl
+      bytes({0xD3, 0xC0 | (ext << 3)});
+    }
+    auto setcc(const Cond cond) -> void {                      // setcc al; movzx eax, al
+      bytes({0x0F, 0x90u | cond, 0xC0, 0x0F, 0xB6, 0xC0});
+    }
+    auto cmov(const Cond cond) -> void {                       // cmovcc eax, edx
+      bytes({0x0F, 0x40u | cond, 0xC2});
+    }
+    auto jcc(const Cond cond) -> u32 {                         // jcc rel32, returns fixup
+      bytes({0x0F, 0x80u | cond});
+      dword(0);
+      return static_cast<u32>(code.size());
+    }
+    auto bind(const u32 fixup) -> void {
+      const u32 rel = static_cast<u32>(code.size()) - fixup;
+      std::memcpy(code.data() + fixup - 4, &rel, 4);
+    }
+    auto addInstret(const u32 count) -> void {                 // add qword [rbx + instret], imm32
+      if (count == 0)
+        return;
+      bytes({0x48, 0x81, 0x83});
+      dword(offsetof(JitContext, instret));
+      dword(count);
+    }
+    auto setField(const u32 offset, const u32 value) -> void { // mov dword [rbx + offset], imm32
+      ctxOp(0xC7, 0, offset);
+      dword(value);
+    }
+  };
+
+  enum AluExt: u32 { AluAdd = 0, AluOr = 1, AluAnd = 4, AluSub = 5, AluXor = 6, AluCmp = 7 };
+  enum ShiftExt: u32 { ShiftLeft = 4, ShiftRight = 5, ShiftArith = 7 };
+
+  struct PendingExit {
+    u32 fixup;
+    JitExit reason;
+    u32 pc;       // returned pc
+    u32 retired;  // instructions of the block completed at this exit
+    u32 size;     // store size for JitExit::Store
+  };
+}
+
+auto JitCompile(const Block &block, JitCodeBuffer &buffer) -> Block::NativeCode {
+#if JIT_X86_64
+  using ID = InstTag::ID;
+
+  Emitter e;
+  std::vector<PendingExit> exits;
+
+  // prologue: push rbx; push r12; push r13; mov rbx, rdi; mov r12, [rbx + memory]; mov r13, [rbx + code]
+  e.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB});
+  e.bytes({0x4C, 0x8B, 0xA3}); e.dword(offsetof(JitContext, memory));
+  e.bytes({0x4C, 0x8B, 0xAB}); e.dword(offsetof(JitContext, code));
+
+  const u32 length = static_cast<u32>(block.ops.size());
+  bool terminated = false;
+
+  for (u32 index = 0; index < length; ++index) {
+    const MicroOp *inst = block.ops[index].inst;
+    const u32 pc = block.start + 4 * index;
+    const u32 rd = inst->rd, rs1 = inst->rs1, rs2 = inst->rs2, imm = inst->imm;
+
+    // guest address into eax; accesses go to [r12 + rax] unchecked, pages
+    // that are not committed yet fault into Memory's handler
+    const auto address = [&]() {
+      e.loadReg(0, rs1);
+      e.aluImm(AluAdd, imm);
+    };
+    const auto load = [&](std::initializer_list<u32> op) {
+      address();
+      e.bytes(op);                  // mov/movzx/movsx eax, [r12 + rax]
+      e.storeReg(rd, 0);
+    };
+    const auto store = [&](std::initializer_list<u32> op, const u32 size) {
+      address();
+      e.loadReg(2, rs2);
+      e.bytes(op);                  // mov [r12 + rax], dl / dx / edx
+      // leave if the first or last byte lands in a translated word, all of
+      // which are below CODE_SIZE: cmp eax, CODE_SIZE; jae past the checks
+      e.aluImm(AluCmp, CODE_SIZE);
+      const u32 past = e.jcc(AboveEqual);
+      // mov ecx, eax; shr ecx, 2; cmp byte [r13 + rcx], 0; jne
+      e.bytes({0x89, 0xC1, 0xC1, 0xE9, 0x02, 0x41, 0x80, 0x7C, 0x0D, 0x00, 0x00});
+      exits.push_back(PendingExit{e.jcc(NotEqual), JitExit::Store, pc + 4, index + 1, size});
+      if (size > 1) {
+        // lea ecx, [rax + size - 1]; shr ecx, 2; cmp byte [r13 + rcx], 0; jne
+        e.bytes({0x8D, 0x48, size - 1, 0xC1, 0xE9, 0x02, 0x41, 0x80, 0x7C, 0x0D, 0x00, 0x00});
+        exits.push_back(PendingExit{e.jcc(NotEqual), JitExit::Store, pc + 4, index + 1, size});
+      }
+      e.bind(past);
+    };
+    const auto aluri = [&](const AluExt ext) {
+      e.loadReg(0, rs1); e.aluImm(ext, imm); e.storeReg(rd, 0);
+    };
+    const auto alurr = [&](const u32 opcode) {
+      e.loadReg(0, rs1); e.aluReg(opcode, rs2); e.storeReg(rd, 0);
+    };
+    const auto compare = [&](const Cond cond, const bool immediate) {
+      e.loadReg(0, rs1);
+      if (immediate) e.aluImm(AluCmp, imm); else e.aluReg(0x3B, rs2);
+      e.setcc(cond);
+      e.storeReg(rd, 0);
+    };
+    const auto shift = [&](const ShiftExt ext, const bool immediate) {
+      e.loadReg(0, rs1);
+      if (immediate) e.shiftImm(ext, imm);
+      else { e.loadReg(1, rs2); e.shiftCl(ext); }
+      e.storeReg(rd, 0);
+    };
+    const auto branch = [&](const Cond cond) {
+      e.loadReg(0, rs1);
+      e.aluReg(0x3B, rs2);          // cmp eax, x[rs2]
+      e.movImm(0, pc + 4);          // mov does not touch the flags
+      e.movImm(2, pc + imm);
+      e.cmov(cond);
+      terminated = true;
+    };
+
+    switch (inst->kind) {
+    case ID::ADDI:  aluri(AluAdd); break;
+    case ID::ANDI:  aluri(AluAnd); break;
+    case ID::ORI:   aluri(AluOr);  break;
+    case ID::XORI:  aluri(AluXor); break;
+    case ID::SLTI:  compare(Less, true); break;
+    case ID::SLTIU: compare(Below, true); break;
+    case ID::SLLI:  shift(ShiftLeft, true); break;
+    case ID::SRLI:  shift(ShiftRight, true); break;
+    case ID::SRAI:  shift(ShiftArith, true); break;
+    case ID::LUI:   e.storeImm(rd, imm); break;
+    case ID::AUIPC: e.storeImm(rd, pc + imm); break;
+    case ID::ADD:   alurr(0x03); break;
+    case ID::SUB:   alurr(0x2B); break;
+    case ID::AND:   alurr(0x23); break;
+    case ID::OR:    alurr(0x0B); break;
+    case ID::XOR:   alurr(0x33); break;
+    case ID::SLT:   compare(Less, false); break;
+    case ID::SLTU:  compare(Below, false); break;
+    case ID::SLL:   shift(ShiftLeft, false); break;
+    case ID::SRL:   shift(ShiftRight, false); break;
+    case ID::SRA:   shift(ShiftArith, false); break;
+    case ID::LB:    load({0x41, 0x0F, 0xBE, 0x04, 0x04}); break;
+    case ID::LH:    load({0x41, 0x0F, 0xBF, 0x04, 0x04}); break;
+    case ID::LW:    load({0x41, 0x8B, 0x04, 0x04}); break;
+    case ID::LBU:   load({0x41, 0x0F, 0xB6, 0x04, 0x04}); break;
+    case ID::LHU:   load({0x41, 0x0F, 0xB7, 0x04, 0x04}); break;
+    case ID::SB:    store({0x41, 0x88, 0x14, 0x04}, 1); break;
+    case ID::SH:    store({0x66, 0x41, 0x89, 0x14, 0x04}, 2); break;
+    case ID::SW:    store({0x41, 0x89, 0x14, 0x04}, 4); break;
+    case ID::BEQ:   branch(Equal);  break;
+    case ID::BNE:   branch(NotEqual); break;
+    case ID::BLT:   branch(Less);  break;
+    case ID::BGE:   branch(GreaterEqual); break;
+    case ID::BLTU:  branch(Below);  break;
+    case ID::BGEU:  branch(AboveEqual); break;
+    case ID::JAL:
+      e.storeImm(rd, pc + 4);
+      e.movImm(0, pc + imm);
+      terminated = true;
+      break;
+    case ID::JALR:
+      e.loadReg(0, rs1);
+      e.aluImm(AluAdd, imm);
+      e.aluImm(AluAnd, ~1u);
+      e.storeImm(rd, pc + 4);
+      terminated = true;
+      break;
+    default:
+      return nullptr;   // left to the interpreter
+    }
+  }
+
+  if (!terminated)
+    e.movImm(0, block.end);
+  e.addInstret(length);
+
+  // epilogue: pop r13; pop r12; pop rbx; ret
+  const auto epilogue = [&]() { e.bytes({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3}); };
+  epilogue();
+
+  for (const PendingExit &exit : exits) {
+    e.bind(exit.fixup);
+    e.ctxOp(0x89, 0, offsetof(JitContext, address));          // mov [rbx + address], eax
+    if (exit.reason == JitExit::Store)
+      e.setField(offsetof(JitContext, storeSize), exit.size);
+    e.setField(offsetof(JitContext, exit), static_cast<u32>(exit.reason));
+    e.addInstret(exit.retired);
+    e.movImm(0, exit.pc);
+    epilogue();
+  }
+
+  return buffer.install(e.code);
+#else
+  (void)block; (void)buffer;
+  return nullptr;
+#endif
+}
+
+//===----------------------------------------------------------------------===//
+// Dispatcher
+//===----------------------------------------------------------------------===//
+
+auto Executor::runJit() -> u32 {
+  JitContext ctx{};
+  ctx.memory = mem.base;
+  ctx.code = blockCache.translated.data();
+
+  const auto toContext = [&]() {
+    for (u32 i = 0; i < 32; ++i)
+      ctx.x[i] = RF[i];
+  };
+  const auto fromContext = [&]() {
+    for (u32 i = 1; i < 32; ++i)
+      RF.writeThrough(i, ctx.x[i]);
+  };
+
+  u32 npc = pc;
+  Block *block = nullptr;
+  toContext();
+
+  for (;;) {
+    if (blockCache.dirty) {
+      // compiled code only notifies stores to translated words, and the
+      // flush forgets which those were: decoded words outside the blocks
+      // translated from now on could go stale unnoticed, so drop them too
+      blockCache.flush();
+      decodeCache.flush();
+      jitCode.reset();
+      block = nullptr;
+    }
+    if (block == nullptr) {
+      ++blockCache.dispatched;
+      if constexpr (!NOASSERT)
+        assert(npc < CODE_SIZE && "pc exceeds CODE_SIZE");
+      block = blockCache.lookup(npc);
+      if (block == nullptr)
+        block = translateBlock(npc);
+    }
+
+    if (block->halt) {
+      halted = true;
+      fromContext();
+      instret += ctx.instret;
+      dumpFunctionalStats();
+      if constexpr (DumpOptions::DumpJitStats)
+        LOG("jit:                  %llu blocks compiled (%llu bytes), %llu of %llu instructions native\n",
+          jitCompiled, jitCode.used, ctx.instret, instret);
+      break;
+    }
+
+    if (block->native == nullptr and UseJit and ++block->heat == JitThreshold) {
+      block->native = JitCompile(*block, jitCode);
+      if (block->native)
+        ++jitCompiled;
+      else if (jitCode.available() and jitCode.used + (64u << 10) > JitCodeBuffer::Capacity)
+        blockCache.dirty = true;   // out of code space: start over at the next block boundary
+    }
+
+    if (block->native) {
+      ctx.exit = JitExit::Normal;
+      npc = block->native(&ctx);
+      if (ctx.exit == JitExit::Store)
+        mem.notify(ctx.address, ctx.storeSize);
+    } else {
+      fromContext();
+      u32 cur = block->start;
+      for (const Block::Op &op : block->ops) {
+        npc = op.step(op.inst, cur, RF, mem);
+        cur += 4;
+        ++instret;
+        if constexpr (DumpOptions::DumpInst)   // compiled blocks are not traced
+          op.inst->dump();
+        if constexpr (DumpOptions::DumpRegState) {
+          RF.dump();
+          LOG("\n\n");
+        }
+        if (blockCache.dirty)
+          break;
+      }
+      toContext();
+    }
+
+    if constexpr (DumpOptions::ClkLimit > 0)
+      if (instret + ctx.instret >= DumpOptions::ClkLimit) {
+        fromContext();
+        instret += ctx.instret;
+        break;
+      }
+
+    if (blockCache.dirty)
+      continue;
+
+    if (Block *next = block->successor(npc)) {
+      ++blockCache.chained;
+      block = next;
+      continue;
+    }
+
+    ++blockCache.dispatched;
+    if constexpr (!NOASSERT)
+      assert(npc < CODE_SIZE && "pc exceeds CODE_SIZE");
+    Block *next = blockCache.lookup(npc);
+    if (next == nullptr)
+      next = translateBlock(npc);
+    block->link(npc, next);
+    block = next;
+  }
+
+  pc = npc; pc.tick();
+  return RF[10] & 255u;
+}
@@ -0,0 +1,152 @@
+#include "Lockstep.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  // one copy of the group loop per vector width, picked when the program starts
+  #define LOCKSTEP_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+  #define LOCKSTEP_TARGETS
+#endif
+
+namespace {
+  constexpr u32 Lanes = LockstepGroup::Lanes;
+
+  /// retire `shared`, of statically known kind, on every lane in `mask`. the
+  /// lane loops are Retire() for one lane, split so that they vectorize: all
+  /// lanes compute and only the masked ones keep their results. loads and
+  /// stores go to each lane's own memory one lane at a time.
+  template <InstTag::ID Kind>
+  [[gnu::always_inline]] inline auto Step(LockstepGroup &group, const MicroOp &shared, const u32 mask) -> void {
+    using namespace InstTag;
+    const u32 pc = shared.pc;
+    alignas(64) u32 result[Lanes], next[Lanes];
+    for (u32 lane = 0; lane < Lanes; ++lane) {
+      MicroOp op = shared;
+      op.rs1v = group.x[shared.rs1][lane];
+      op.rs2v = group.x[shared.rs2][lane];
+      Execute<Kind>(op);
+      result[lane] = op.rdv;
+      next[lane] = pc + 4;
+      if constexpr (IsBranch(Kind))
+        next[lane] = op.cond ? pc + op.imm : pc + 4;
+      else if constexpr (Kind == ID::JAL)
+        next[lane] = pc + op.imm;
+      else if constexpr (Kind == ID::JALR)
+        next[lane] = op.indirectTarget();
+    }
+
+    if constexpr (IsLoad(Kind) or IsStore(Kind))
+      for (u32 rest = mask; rest != 0; rest &= rest - 1) {
+        const u32 lane = static_cast<u32>(__builtin_ctz(rest));
+        MicroOp op = shared;
+        op.rs1v = group.x[shared.rs1][lane];
+        op.rs2v = group.x[shared.rs2][lane];
+        op.rdv = result[lane];
+        MemAccess<Kind>(op, group.mem[lane]);
+        result[lane] = op.rdv;
+        // only words below CODE_SIZE are ever fetched
+        if constexpr (IsStore(Kind))
+          if (const u32 address = op.rs1v + op.imm; address < CODE_SIZE) {
+            group.written[address >> 2] |= 1u << lane;
+            group.written[(address + sizeof(u32) - 1) >> 2] |= 1u << lane;
+          }
+      }
+
+    if constexpr (WritesRd(Kind))
+      if (shared.rd != 0)
+        for (u32 lane = 0; lane < Lanes; ++lane)
+          group.x[shared.rd][lane] = (mask >> lane) & 1u ? result[lane] : group.x[shared.rd][lane];
+    for (u32 lane = 0; lane < Lanes; ++lane) {
+      const u32 active = (mask >> lane) & 1u;
+      group.pc[lane] = active ? next[lane] : group.pc[lane];
+      group.instret[lane] += active;
+    }
+  }
+}
+
+auto LockstepGroup::run() -> void {
+  for (u32 reg = 0; reg < 32; ++reg)
+    for (u32 lane = 0; lane < Lanes; ++lane)
+      x[reg][lane] = 0;
+  for (u32 lane = 0; lane < Lanes; ++lane)
+    pc[lane] = entry[lane], instret[lane] = 0, ret[lane] = 0;
+  std::fill_n(written.get(), (CODE_SIZE >> 2) + 1, 0u);
+  running = loaded;
+  faulted = 0;
+  steps = 0;
+
+  // lanes loaded with the same image as the first one fetch the same words
+  // until they store over them, so those need no per-lane check
+  sameImage = 0;
+  if (loaded != 0) {
+    const Memory &reference = mem[__builtin_ctz(loaded)];
+    for (u32 lane = 0; lane < Lanes; ++lane)
+      if ((loaded >> lane) & 1u and mem[lane].equals(reference))
+        sameImage |= 1u << lane;
+  }
+
+  // a faulting lane stops where it is and the others go on. The step it
+  // interrupted is taken again from the start, which is safe because lanes
+  // share no memory: each of them loads the same values or stores them again.
+  for (u32 lane = 0; lane < Lanes; ++lane)
+    mem[lane].fault.reset();
+  while (!TrapGuestFaults([&] { advance(); }))
+    for (u32 lane = 0; lane < Lanes; ++lane)
+      if ((running >> lane) & 1u and mem[lane].fault) {
+        LogGuestFault(*mem[lane].fault);
+        running &= ~(1u << lane);
+        faulted |= 1u << lane;
+      }
+}
+
+LOCKSTEP_TARGETS auto LockstepGroup::advance() -> void {
+  u32 at = 0, mask = 0;
+  bool together = false;  // `at` and `mask` still hold: the last step ran every lane through straight-line code
+  while (running != 0) {
+    if (!together) {
+      // the lowest pc goes first: lanes ahead wait for the others to catch up
+      at = ~0u;
+      for (u32 lane = 0; lane < Lanes; ++lane)
+        at = std::min(at, (running >> lane) & 1u ? pc[lane] : ~0u);
+      mask = 0;
+      for (u32 lane = 0; lane < Lanes; ++lane)
+        mask |= static_cast<u32>((running >> lane) & 1u and pc[lane] == at) << lane;
+    }
+
+    if constexpr (!NOASSERT)
+      assert(at < CODE_SIZE && "pc exceeds CODE_SIZE");
+
+    // lanes holding another word at `at` take a later step of their own
+    const u32 encoding = mem[__builtin_ctz(mask)].load<u32>(at);
+    if ((mask & ~sameImage) != 0 or (written[at >> 2] & mask) != 0)
+      for (u32 rest = mask & (mask - 1); rest != 0; rest &= rest - 1) {
+        const u32 lane = static_cast<u32>(__builtin_ctz(rest));
+        if (mem[lane].load<u32>(at) != encoding)
+          mask &= ~(1u << lane);
+      }
+    ++steps;
+
+    if (encoding == HaltEncoding) {
+      for (u32 lane = 0; lane < Lanes; ++lane)
+        if ((mask >> lane) & 1u)
+          ret[lane] = x[10][lane] & 255u;
+      running &= ~mask;
+      together = false;
+      continue;
+    }
+
+    const MicroOp op = decodeCache.lookup(encoding, at);
+    // whether the step ends straight-line code is known per kind at compile
+    // time, so no table is indexed by a kind outside the switch
+    #define GENCASE(MNEMONIC, ...)                                                      \
+      case InstTag::ID::MNEMONIC:                                                       \
+        Step<InstTag::ID::MNEMONIC>(*this, op, mask);                                   \
+        together = mask == running and !InstTag::IsControl(InstTag::ID::MNEMONIC);      \
+        break;
+    switch (op.kind) {
+      RV32I_INSTTAGS(INSTTAG_IGNORE, GENCASE, GENCASE, GENCASE, GENCASE, GENCASE, GENCASE)
+      GENCASE(Unknown)
+    }
+    #undef GENCASE
+    at += 4;
+  }
+}
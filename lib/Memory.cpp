@@ -0,0 +1,202 @@
+#include "Memory.hpp"
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+thread_local GuestFaultTrap *CurrentGuestFaultTrap = nullptr;
+
+namespace {
+  // every live Memory, for the fault handler to find the one a fault hit;
+  // each reserves 4 GiB, so the host runs out of address space long before
+  // this runs out of slots
+  constexpr u32 MaxMemories = 4096;
+  std::atomic<Memory *> Owners[MaxMemories];
+
+  struct sigaction Previous;
+
+  auto Owner(const u8 *host) -> Memory * {
+    for (std::atomic<Memory *> &slot : Owners) {
+      Memory *mem = slot.load(std::memory_order_acquire);
+      if (mem != nullptr and host >= mem->base and host < mem->base + Memory::Reserved)
+        return mem;
+    }
+    return nullptr;
+  }
+
+  /// the faulting access was a write; where the host does not say, assume
+  /// it was, which costs a page for a read but never loops
+  auto IsWrite(const void *context) -> bool {
+#if defined(__x86_64__) && defined(__linux__)
+    return (static_cast<const ucontext_t *>(context)->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+#else
+    (void)context;
+    return true;
+#endif
+  }
+
+  auto OnFault(const i32 signal, siginfo_t *info, void *context) -> void {
+    Memory *mem = Owner(static_cast<const u8 *>(info->si_addr));
+    if (mem == nullptr) {
+      // not a guest access: fault again under whatever handled it before
+      sigaction(signal, &Previous, nullptr);
+      return;
+    }
+    const u64 address = static_cast<u64>(static_cast<const u8 *>(info->si_addr) - mem->base);
+    if (address >> Memory::PageBits >= Memory::PageCount)
+      mem->fault = GuestFault{address, IsWrite(context), "access runs past the top of the address space"};
+    else {
+      // a page the handler already made writable cannot fault again
+      const u32 number = static_cast<u32>(address >> Memory::PageBits);
+      if (mem->state[number] != Memory::Written) {
+        mem->commit(number, IsWrite(context) or mem->state[number] == Memory::Readable);
+        return;
+      }
+      mem->fault = GuestFault{address, true, "unexpected fault on a written page"};
+    }
+    if (CurrentGuestFaultTrap != nullptr)
+      siglongjmp(CurrentGuestFaultTrap->resume, 1);
+    LogGuestFault(*mem->fault);
+    _exit(1);
+  }
+
+  auto InstallFaultHandler() -> bool {
+    struct sigaction action{};
+    action.sa_sigaction = OnFault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGSEGV, &action, &Previous) == 0;
+  }
+
+  /// stop the current trapped run at `fault`, or the process outside one
+  [[noreturn]] auto Raise(Memory &mem, const GuestFault &fault) -> void {
+    mem.fault = fault;
+    if (CurrentGuestFaultTrap != nullptr)
+      siglongjmp(CurrentGuestFaultTrap->resume, 1);
+    LogGuestFault(fault);
+    _exit(1);
+  }
+}
+
+auto LogGuestFault(const GuestFault &fault) -> void {
+  // formatted on the stack and written at once: this also runs in the signal handler
+  char line[160];
+  const i32 length = snprintf(line, sizeof line, "guest fault: %s at %08llx: %s\n",
+    fault.write ? "write" : "read", fault.address, fault.reason);
+  if (length > 0)
+    (void)!::write(2, line, std::min<std::size_t>(static_cast<std::size_t>(length), sizeof line - 1));
+}
+
+// the reservation is address space only: nothing is backed until committed
+Memory::Memory(): base(nullptr), state(nullptr), touched{}, observers{}, fault{} {
+  static const bool installed = InstallFaultHandler();
+  if (!installed)
+    throw std::bad_alloc();
+
+  void *reserved = mmap(nullptr, Reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  void *states = mmap(nullptr, PageCount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserved == MAP_FAILED or states == MAP_FAILED) {
+    if (reserved != MAP_FAILED) munmap(reserved, Reserved);
+    if (states != MAP_FAILED) munmap(states, PageCount);
+    throw std::bad_alloc();
+  }
+  base = static_cast<u8 *>(reserved);
+  state = static_cast<u8 *>(states);
+  // the handler appends to it, where it must not allocate
+  touched.reserve(LimitPages);
+
+  for (std::atomic<Memory *> &slot : Owners) {
+    Memory *empty = nullptr;
+    if (slot.compare_exchange_strong(empty, this, std::memory_order_acq_rel))
+      return;
+  }
+  munmap(base, Reserved);
+  munmap(state, PageCount);
+  throw std::bad_alloc();
+}
+
+Memory::~Memory() {
+  for (std::atomic<Memory *> &slot : Owners)
+    if (slot.load(std::memory_order_relaxed) == this)
+      slot.store(nullptr, std::memory_order_release);
+  munmap(base, Reserved);
+  munmap(state, PageCount);
+}
+
+auto Memory::commit(const u32 number, const bool write, const u32 count) -> void {
+  const u64 address = (u64)number << PageBits;
+  if (write and touched.size() + count > LimitPages)
+    Raise(*this, GuestFault{address, true, "guest memory limit reached"});
+  if (mprotect(base + address, (u64)count * PageSize, write ? PROT_READ | PROT_WRITE : PROT_READ) != 0)
+    Raise(*this, GuestFault{address, write, "the host cannot map the page"});
+  for (u32 page = number; page < number + count; ++page) {
+    if (write and state[page] != Written)
+      touched.push_back(page);
+    state[page] = write ? Written : Readable;
+  }
+}
+
+auto Memory::read(u32 address, void *data, u32 size) const -> void {
+  u8 *out = static_cast<u8 *>(data);
+  while (size > 0) {
+    const u32 offset = address & PageMask;
+    const u32 chunk = std::min(size, PageSize - offset);
+    if (const u8 *page = find(address))
+      std::memcpy(out, page + offset, chunk);
+    else
+      std::memset(out, 0, chunk);
+    out += chunk, address += chunk, size -= chunk;
+  }
+}
+
+auto Memory::write(u32 address, const void *data, u32 size) -> void {
+  // commit the pages in one call where they are not written yet, as a
+  // snapshot extent or an ELF segment usually is not
+  if (size > PageSize) {
+    const u32 first = address >> PageBits;
+    const u32 last = std::min<u64>((u64)address + size - 1, 0xffffffffu) >> PageBits;
+    if (std::find(state + first, state + last + 1, static_cast<u8>(Written)) == state + last + 1)
+      commit(first, true, last - first + 1);
+  }
+  const u8 *in = static_cast<const u8 *>(data);
+  while (size > 0) {
+    const u32 offset = address & PageMask;
+    const u32 chunk = std::min(size, PageSize - offset);
+    std::memcpy(page(address) + offset, in, chunk);
+    in += chunk, address += chunk, size -= chunk;
+  }
+}
+
+// written pages go back to the zero page, read-only, one call per run of
+// adjacent pages; read-only pages are zero already
+auto Memory::clear() -> void {
+  std::sort(touched.begin(), touched.end());
+  for (std::size_t first = 0, last; first < touched.size(); first = last) {
+    for (last = first + 1; last < touched.size() and touched[last] == touched[last - 1] + 1;)
+      ++last;
+    u8 *run = base + ((u64)touched[first] << PageBits);
+    const std::size_t bytes = (last - first) * PageSize;
+    madvise(run, bytes, MADV_DONTNEED);
+    mprotect(run, bytes, PROT_READ);
+    std::fill_n(state + touched[first], last - first, static_cast<u8>(Readable));
+  }
+  touched.clear();
+}
+
+auto Memory::equals(const Memory &other) const -> bool {
+  static const u8 zero[PageSize] = {};
+  const auto same = [](const Memory &a, const Memory &b) {
+    for (const u32 number : a.touched) {
+      const u8 *theirs = b.find(number << PageBits);
+      if (std::memcmp(a.find(number << PageBits), theirs != nullptr ? theirs : zero, PageSize) != 0)
+        return false;
+    }
+    return true;
+  };
+  // pages only one side has must be all zero; pages both have are compared twice
+  return same(*this, other) and same(other, *this);
+}
@@ -0,0 +1,99 @@
+#include "MicroOp.hpp"
+
+using InstTag::ID;
+
+auto MicroOp::Extract(const ID kind, const u32 encoding, const u32 pc) -> MicroOp {
+  MicroOp op = Fetched(encoding, pc);
+  op.kind = kind;
+  op.rs1 = cast<u8>(getbits<19, 15>(encoding));
+  op.rs2 = cast<u8>(getbits<24, 20>(encoding));
+  op.rd = cast<u8>(getbits<11, 7>(encoding));
+
+  // operands the format does not have are zeroed
+  switch (InstTag::FormatOf(kind)) {
+  case InstFormat::R:
+    break;
+  case InstFormat::I:
+    op.rs2 = 0;
+    op.imm = SExt<12>(getbits<31, 20>(encoding));
+    if (kind == ID::SLLI or kind == ID::SRLI or kind == ID::SRAI)
+      op.imm &= 0b11111u;
+    break;
+  case InstFormat::S:
+    op.rd = 0;
+    op.imm = SExt<12>((getbits<31, 25>(encoding) << 5) + getbits<11, 7>(encoding));
+    break;
+  case InstFormat::B:
+    op.rd = 0;
+    op.imm = SExt<13>(
+      (getbits<31>(encoding) << 12)
+    + (getbits<7>(encoding) << 11)
+    + (getbits<30, 25>(encoding) << 5)
+    + (getbits<11, 8>(encoding) << 1));
+    break;
+  case InstFormat::U:
+    op.rs1 = op.rs2 = 0;
+    op.imm = getbits<31, 12>(encoding) << 12;
+    break;
+  case InstFormat::J:
+    op.rs1 = op.rs2 = 0;
+    op.imm = SExt<21>(
+      (getbits<31>(encoding) << 20)
+    + (getbits<19, 12>(encoding) << 12)
+    + (getbits<20>(encoding) << 11)
+    + (getbits<30, 21>(encoding) << 1));
+    break;
+  case InstFormat::None:
+    break;
+  }
+  return op;
+}
+
+auto MicroOp::dump() const -> void {
+  // a fused micro-op is shown at its head, with the head's bytes
+  LOG("%5x: %02x %02x %02x %02x", fusion == FusedPair::None ? pc : pc - 4,
+    getbits<7, 0>(encoding), getbits<15, 8>(encoding),
+    getbits<23, 16>(encoding), getbits<31, 24>(encoding));
+  putn(' ', 10);
+  if (fusion == FusedPair::None)
+    AlignedLOG<DumpOptions::OpcodestrAlign>("%s", InstTag::Opcodestrs[static_cast<u32>(kind)]);
+  else
+    AlignedLOG<DumpOptions::OpcodestrAlign>("%s+%s", GetOpcode(encoding) == InstTag::OPC_LUI ? "lui" : "auipc",
+      InstTag::Opcodestrs[static_cast<u32>(kind)]);
+
+  const u32 shown = DumpOptions::DumpTargetAddr ? pc + imm : imm;
+  switch (InstTag::FormatOf(kind)) {
+  case InstFormat::R:
+    // $rd, $rs1, $rs2
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s, %s, %s", regname[rd], regname[rs1], regname[rs2]);
+    break;
+  case InstFormat::I:
+    if (InstTag::IsLoad(kind) or kind == ID::JALR)
+      // $rd, $imm12($rs1)
+      AlignedLOG<DumpOptions::ArgstrAlign>("%s, 0x%x(%s)", regname[rd], imm, regname[rs1]);
+    else
+      // $rd, $rs1, $imm12
+      AlignedLOG<DumpOptions::ArgstrAlign>("%s, %s, 0x%x", regname[rd], regname[rs1], imm);
+    break;
+  case InstFormat::S:
+    // $rs2, $imm12($rs1)
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s, 0x%x(%s)", regname[rs2], imm, regname[rs1]);
+    break;
+  case InstFormat::B:
+    // $rs1, $rs2, $imm13
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s, %s, 0x%x", regname[rs1], regname[rs2], shown);
+    break;
+  case InstFormat::U:
+    // $rd, $imm20
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s, 0x%x", regname[rd], imm);
+    break;
+  case InstFormat::J:
+    // $rd, $imm21
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s, 0x%x", regname[rd], shown);
+    break;
+  case InstFormat::None:
+    AlignedLOG<DumpOptions::ArgstrAlign>("%s", "");
+    break;
+  }
+  LOG("\n");
+}
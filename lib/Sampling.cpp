@@ -0,0 +1,83 @@
+#include "Sampling.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+  /// what one window measured, as deltas of the executor's counters
+  struct Sample {
+    u64 cycles;
+    u64 instret;
+    u64 hits;
+    u64 predictions;
+  };
+
+  /// sum(y) / sum(x) over the samples, with the usual variance of a ratio
+  /// estimator: s^2 of the residuals y - R x, over n mean(x)^2
+  template <typename Y, typename X>
+  auto Ratio(const std::vector<Sample> &samples, Y &&y, X &&x) -> Estimate {
+    f64 sumY = 0, sumX = 0;
+    for (const Sample &sample : samples)
+      sumY += (f64)y(sample), sumX += (f64)x(sample);
+    if (sumX == 0)
+      return Estimate{0, 0};
+    const f64 ratio = sumY / sumX;
+    const f64 n = (f64)samples.size();
+    if (samples.size() < 2)
+      return Estimate{ratio, 0};
+    f64 squares = 0;
+    for (const Sample &sample : samples) {
+      const f64 residual = (f64)y(sample) - ratio * (f64)x(sample);
+      squares += residual * residual;
+    }
+    const f64 meanX = sumX / n;
+    const f64 standardError = std::sqrt(squares / (n - 1) / n) / meanX;
+    return Estimate{ratio, 1.96 * standardError};
+  }
+}
+
+auto RunSampled(Executor &executor, const SamplingOptions &options) -> SampledRun {
+  // a checkpoint taken inside the pipeline starts as if paused after a window
+  if (executor.restored and executor.inFlight())
+    executor.squash();
+
+  std::vector<Sample> samples;
+  u64 detailedCycles = 0;
+  const auto stopped = [&] { return executor.halted or executor.mem.fault.has_value(); };
+  const auto pipelineFor = [&](const u64 cycles) {
+    const u64 start = executor.cycles;
+    executor.pauseAt = start + cycles;
+    const u32 ret = executor.resume(Engine::Pipeline);
+    detailedCycles += executor.cycles - start;
+    return ret;
+  };
+
+  executor.pauseAt = (executor.restored ? executor.instret : 0) + options.period;
+  u32 ret = executor.run(Engine::Functional);
+  while (!stopped()) {
+    ret = pipelineFor(options.warmup);
+    if (stopped())
+      break;
+    const Sample before{executor.cycles, executor.instret, executor.predictor.hit, executor.predictor.total};
+    ret = pipelineFor(options.window);
+    if (stopped())
+      break;
+    samples.push_back(Sample{executor.cycles - before.cycles, executor.instret - before.instret,
+      executor.predictor.hit - before.hits, executor.predictor.total - before.predictions});
+    executor.squash();
+
+    executor.pauseAt = executor.instret + options.period;
+    ret = executor.resume(Engine::Functional);
+  }
+  executor.pauseAt = ~0ull;
+
+  SampledRun result{};
+  result.faulted = executor.mem.fault.has_value();
+  result.ret = result.faulted ? 0 : ret;
+  result.instret = executor.instret;
+  result.samples = samples.size();
+  result.detailedCycles = detailedCycles;
+  result.cpi = Ratio(samples, [](const Sample &s) { return s.cycles; }, [](const Sample &s) { return s.instret; });
+  result.accuracy = Ratio(samples, [](const Sample &s) { return s.hits; }, [](const Sample &s) { return s.predictions; });
+  return result;
+}
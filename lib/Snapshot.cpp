@@ -0,0 +1,132 @@
+#include "Snapshot.hpp"
+#include "Memory.hpp"
+
+// 64-bit FNV-1a over 8-byte words, then over the tail bytes: a hash of the
+// whole file at memcpy-like speed
+auto WordChecksum(const char *data, const std::size_t size) -> u64 {
+  constexpr u64 Prime = 0x100000001b3ull;
+  u64 hash = 0xcbf29ce484222325ull;
+  std::size_t at = 0;
+  for (; at + sizeof(u64) <= size; at += sizeof(u64)) {
+    u64 word;
+    std::memcpy(&word, data + at, sizeof word);
+    hash = (hash ^ word) * Prime;
+  }
+  for (; at < size; ++at)
+    hash = (hash ^ static_cast<u8>(data[at])) * Prime;
+  return hash;
+}
+
+namespace {
+  /// the checksum of a snapshot: every byte that follows the checksum field
+  auto SnapshotChecksum(const char *begin, const char *end) -> u64 {
+    constexpr std::size_t after = offsetof(SnapshotHeader, checksum) + sizeof(u64);
+    return WordChecksum(begin + after, static_cast<std::size_t>(end - begin) - after);
+  }
+
+  auto Reject(const char *reason) -> std::nullopt_t {
+    LOG("not a loadable snapshot: %s\n", reason);
+    return std::nullopt;
+  }
+}
+
+auto NonzeroExtents(const Memory &mem, const u32 gap) -> std::vector<SnapshotExtent> {
+  std::vector<u32> numbers = mem.touched;
+  std::sort(numbers.begin(), numbers.end());
+
+  std::vector<SnapshotExtent> extents;
+  for (const u32 number : numbers) {
+    const u8 *page = mem.find(number << Memory::PageBits);
+    for (u32 offset = 0; offset < Memory::PageSize; ++offset) {
+      // skip zero words whole: pages are mostly empty
+      if (offset % sizeof(u64) == 0) {
+        u64 word;
+        std::memcpy(&word, page + offset, sizeof word);
+        if (word == 0) {
+          offset += sizeof(u64) - 1;
+          continue;
+        }
+      }
+      if (page[offset] == 0)
+        continue;
+      const u32 address = (number << Memory::PageBits) + offset;
+      SnapshotExtent *last = extents.empty() ? nullptr : &extents.back();
+      if (last != nullptr and address - ((u64)last->address + last->size) < gap)
+        last->size = address + 1 - last->address;
+      else
+        extents.push_back(SnapshotExtent{address, 1});
+    }
+  }
+  return extents;
+}
+
+auto WriteSnapshot(const Memory &mem, const u32 entry) -> std::string {
+  const std::vector<SnapshotExtent> extents = NonzeroExtents(mem);
+  SnapshotHeader header{};
+  std::memcpy(header.magic, SnapshotHeader::Magic, sizeof header.magic);
+  header.version = SnapshotHeader::CurrentVersion;
+  header.entry = entry;
+  header.extents = static_cast<u32>(extents.size());
+  // extents are sorted, so only the first page of one may be shared with the last
+  u32 lastPage = ~0u;
+  for (const SnapshotExtent &extent : extents) {
+    const u32 first = extent.address >> Memory::PageBits, last = (extent.address + extent.size - 1) >> Memory::PageBits;
+    header.pages += last - first + (first != lastPage);
+    lastPage = last;
+  }
+
+  std::string snapshot(reinterpret_cast<const char *>(&header), sizeof header);
+  snapshot.append(reinterpret_cast<const char *>(extents.data()), extents.size() * sizeof(SnapshotExtent));
+  for (const SnapshotExtent &extent : extents) {
+    const std::size_t at = snapshot.size();
+    snapshot.resize(at + extent.size);
+    mem.read(extent.address, snapshot.data() + at, extent.size);
+  }
+
+  header.checksum = SnapshotChecksum(snapshot.data(), snapshot.data() + snapshot.size());
+  std::memcpy(snapshot.data() + offsetof(SnapshotHeader, checksum), &header.checksum, sizeof header.checksum);
+  return snapshot;
+}
+
+auto IsSnapshot(const char *begin, const char *end) -> bool {
+  return end - begin >= static_cast<std::ptrdiff_t>(sizeof SnapshotHeader::Magic)
+    and std::memcmp(begin, SnapshotHeader::Magic, sizeof SnapshotHeader::Magic) == 0;
+}
+
+auto LoadSnapshot(const char *begin, const char *end, Memory &mem) -> std::optional<ProgramInfo> {
+  const std::size_t size = static_cast<std::size_t>(end - begin);
+  if (!IsSnapshot(begin, end) or size < sizeof(SnapshotHeader))
+    return Reject("truncated header");
+  SnapshotHeader header;
+  std::memcpy(&header, begin, sizeof header);
+  if (header.version != SnapshotHeader::CurrentVersion)
+    return Reject("unknown version");
+  if ((size - sizeof header) / sizeof(SnapshotExtent) < header.extents)
+    return Reject("truncated extent table");
+  if (SnapshotChecksum(begin, end) != header.checksum)
+    return Reject("checksum mismatch");
+  if (header.entry >= CODE_SIZE or header.entry % 4 != 0)
+    return Reject("entry point not below CODE_SIZE");
+
+  // check every extent before writing any, so a bad snapshot leaves mem alone
+  const char *table = begin + sizeof header;
+  const char *data = table + header.extents * sizeof(SnapshotExtent);
+  u64 total = 0;
+  for (u32 index = 0; index < header.extents; ++index) {
+    SnapshotExtent extent;
+    std::memcpy(&extent, table + index * sizeof extent, sizeof extent);
+    if ((u64)extent.address + extent.size > (1ull << 32))
+      return Reject("extent past the end of the address space");
+    total += extent.size;
+  }
+  if (total != static_cast<u64>(end - data))
+    return Reject("extent bytes do not match the file size");
+
+  for (u32 index = 0; index < header.extents; ++index) {
+    SnapshotExtent extent;
+    std::memcpy(&extent, table + index * sizeof extent, sizeof extent);
+    mem.write(extent.address, data, extent.size);
+    data += extent.size;
+  }
+  return ProgramInfo{header.entry, {}};
+}
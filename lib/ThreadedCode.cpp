@@ -0,0 +1,92 @@
+#include "Executor.hpp"
+
+//===----------------------------------------------------------------------===//
+// Threaded-code interpreter
+//===----------------------------------------------------------------------===//
+
+#if THREADED_COMPUTED_GOTO
+  #define HANDLER(NAME)     L_##NAME:
+  #define DISPATCH()        goto *op->handler
+  #define TARGET(INDEX)     labels[INDEX]
+#else
+  #define HANDLER(NAME)     case Handler::NAME:
+  #define DISPATCH()        goto dispatch
+  #define TARGET(INDEX)     (INDEX)
+#endif
+
+auto Executor::runThreaded() -> u32 {
+#if THREADED_COMPUTED_GOTO
+  #define GENLABEL(MNEMONIC, ...) &&L_##MNEMONIC,
+  static const void *const labels[Handler::NumHandlers] = {
+    &&L_Translate,
+    &&L_Halt,
+    RV32I_INSTTAGS(INSTTAG_IGNORE, GENLABEL, GENLABEL, GENLABEL, GENLABEL, GENLABEL, GENLABEL)
+    &&L_Unknown,
+  };
+  #undef GENLABEL
+  threadedCode.bind(labels[Handler::Translate]);
+#endif
+
+  ThreadedCode::Op *op = nullptr;
+  u32 npc = pc;
+
+  #define NEXT()                                                            \
+    do {                                                                  \
+      ++instret;                                                          \
+      if constexpr (DumpOptions::DumpInst)                                \
+        op->inst->dump();                                                 \
+      if constexpr (DumpOptions::DumpRegState) {                          \
+        RF.dump();                                                        \
+        LOG("\n\n");                                                      \
+      }                                                                   \
+      if constexpr (DumpOptions::ClkLimit > 0)                            \
+        if (instret >= DumpOptions::ClkLimit)                             \
+          goto done;                                                      \
+      if constexpr (!NOASSERT)                                            \
+        assert(npc < CODE_SIZE && "pc exceeds CODE_SIZE");            \
+      op = &threadedCode.ops[npc >> 2];                                   \
+      DISPATCH();                                                         \
+    } while (0)
+
+  #define GENHANDLER(MNEMONIC, ...)                                         \
+    HANDLER(MNEMONIC) {                                                   \
+      npc = Retire<InstTag::ID::MNEMONIC>(op->inst, npc, RF, mem);      \
+      NEXT();                                                             \
+    }
+
+  op = &threadedCode.ops[npc >> 2];
+#if THREADED_COMPUTED_GOTO
+  DISPATCH();
+#else
+dispatch:
+  switch (op->handler) {
+#endif
+
+  HANDLER(Translate) {
+    MicroOp *inst = decodeCache.fetch(mem, npc);
+    op->inst = inst;
+    op->handler = TARGET(inst->encoding == HaltEncoding ? Handler::Halt : Handler::of(inst->kind));
+    ++threadedCode.translations;
+    DISPATCH();
+  }
+
+  HANDLER(Halt) {
+    halted = true;
+    dumpFunctionalStats();
+    goto done;
+  }
+
+  RV32I_INSTTAGS(INSTTAG_IGNORE, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER, GENHANDLER)
+  GENHANDLER(Unknown)
+
+#if !THREADED_COMPUTED_GOTO
+  }
+#endif
+
+  #undef GENHANDLER
+  #undef NEXT
+
+done:
+  pc = npc; pc.tick();
+  return RF[10] & 255u;
+}
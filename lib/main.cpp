@@ -1,14 +1,245 @@
 #include "config.hpp"
-#include "Instruction.hpp"
 #include "Executor.hpp"
+#include "Batch.hpp"
+#include "ForkServer.hpp"
+#include "Sampling.hpp"
+#include "Intervals.hpp"
 
-auto main() -> i32 {
+#include <chrono>
+
+auto main(i32 argc, char **argv) -> i32 {
+  Engine engine = Engine::Pipeline;
+  bool fuse = false;
+  bool lockstep = false;
+  bool serve = false;
+  bool sample = false;
+  SamplingOptions sampling;
+  bool intervals = false;
+  IntervalOptions interval;
+  u32 jobs = DefaultJobs();
+  std::string checkpoint;
+  u64 at = 0;
+  std::vector<std::string> files;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--engine=pipeline")
+      engine = Engine::Pipeline;
+    else if (arg == "--engine=functional")
+      engine = Engine::Functional;
+    else if (arg == "--engine=threaded")
+      engine = Engine::Threaded;
+    else if (arg == "--engine=block")
+      engine = Engine::Block;
+    else if (arg == "--engine=jit")
+      engine = Engine::Jit;
+    else if (arg == "--fuse")
+      fuse = true;
+    else if (arg == "--lockstep")
+      lockstep = true;
+    else if (arg == "--serve")
+      serve = true;
+    else if (arg == "--sample")
+      sample = true;
+    else if (arg.rfind("--sample=", 0) == 0 and arg.size() > 9) {
+      sample = true;
+      sampling.period = std::max(1ull, std::stoull(arg.substr(9)));
+    } else if (arg == "--intervals")
+      intervals = true;
+    else if (arg.rfind("--intervals=", 0) == 0 and arg.size() > 12) {
+      intervals = true;
+      interval.length = std::max(1ull, std::stoull(arg.substr(12)));
+    } else if (arg.rfind("--jobs=", 0) == 0 and arg.size() > 7)
+      jobs = static_cast<u32>(std::max(1, std::stoi(arg.substr(7))));
+    else if (arg.rfind("--checkpoint=", 0) == 0 and arg.size() > 13)
+      checkpoint = arg.substr(13);
+    else if (arg.rfind("--at=", 0) == 0 and arg.size() > 5)
+      at = std::stoull(arg.substr(5));
+    else if (arg[0] != '-')
+      files.push_back(arg);
+    else {
+      LOG("usage: %s [--engine=pipeline|functional|threaded|block|jit] [--fuse] < program.data\n"
+          "       %s [--engine=pipeline|functional] [--fuse] --checkpoint=FILE --at=N < program.data\n"
+          "       %s [--engine=...] [--fuse] [--jobs=N] program.data...\n"
+          "       %s --lockstep [--jobs=N] program.data...\n"
+          "       %s --serve [--engine=...] [--fuse] [--at=N] program.data < runs\n"
+          "       %s --sample[=PERIOD] [--fuse] < program.data\n"
+          "       %s --intervals[=LENGTH] [--jobs=N] [--fuse] < program.data\n",
+          argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+      return 1;
+    }
+  }
+
+  if (fuse and engine != Engine::Pipeline and engine != Engine::Functional) {
+    LOG("--fuse applies to --engine=pipeline and --engine=functional only\n");
+    return 1;
+  }
+
+  if (lockstep and (files.empty() or fuse)) {
+    LOG("--lockstep runs the programs given as arguments, without --fuse\n");
+    return 1;
+  }
+
+  if (serve and (files.size() != 1 or lockstep or !checkpoint.empty())) {
+    LOG("--serve runs one program, given as an argument, without --lockstep or --checkpoint\n");
+    return 1;
+  }
+
+  if (sample and (engine != Engine::Pipeline or !files.empty() or lockstep or serve or !checkpoint.empty())) {
+    LOG("--sample runs one program on stdin, alternating the functional engine and the pipeline by itself\n");
+    return 1;
+  }
+
+  if (intervals and (engine != Engine::Pipeline or !files.empty() or lockstep or serve or sample or !checkpoint.empty())) {
+    LOG("--intervals runs one program on stdin through the pipeline, without the other modes\n");
+    return 1;
+  }
+
+  if ((!checkpoint.empty() and (at == 0 or !files.empty())) or (at != 0 and checkpoint.empty() and !serve)
+      or (at != 0 and engine != Engine::Pipeline and engine != Engine::Functional)) {
+    LOG("--at pauses for --checkpoint, with one program on stdin, or for --serve, with --engine=pipeline or functional\n");
+    return 1;
+  }
+
+  // fork-server mode: the program is loaded (and run up to --at) once, then
+  // every line of stdin is a run of it with those patches, printed as a line
+  if (serve) {
+    auto executor = std::make_unique<Executor>();
+    executor->fuse = fuse;
+    const std::optional<ImageText> text = ImageText::open(files[0].c_str());
+    if (!text or !executor->initMem(*text) or !executor->runnableOn(engine)) {
+      LOG("cannot load %s\n", files[0].c_str());
+      return 1;
+    }
+    if (at != 0)
+      executor->pauseAt = at;
+    if (!ForkServer::Warm(*executor, engine))
+      return 1;
+
+    const ForkServer server{*executor, engine};
+    i32 status = 0;
+    u64 runs = 0;
+    f64 ms = 0;
+    for (std::string line; std::getline(std::cin, line);) {
+      const std::optional<std::vector<InputPatch>> patches = ParsePatches(line);
+      if (!patches) {
+        printf("error\n");
+        status = 1;
+        continue;
+      }
+      const ServedRun result = server.run(*patches);
+      if (!result.completed)
+        printf("crashed\n");
+      else if (result.faulted)
+        printf("fault\n");
+      else
+        printf("%u\n", result.ret);
+      fflush(stdout);
+      status |= !result.completed or result.faulted;
+      ++runs;
+      ms += result.ms;
+    }
+    LOG("serve:                %llu runs, %.3lfms per run\n", runs, runs == 0 ? 0.0 : ms / (f64)runs);
+    return status;
+  }
+
+  // batch mode: one line per program, in the order given
+  if (!files.empty()) {
+    i32 status = 0;
+    u64 instret = 0;
+    f64 loadMs = 0;
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<BatchResult> results = RunBatch(files, BatchOptions{engine, fuse, lockstep, jobs});
+    const f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (const BatchResult &result : results) {
+      if (!result.loaded) {
+        LOG("cannot load %s\n", result.file.c_str());
+        status = 1;
+        continue;
+      }
+      if (result.faulted) {
+        printf("%s fault\n", result.file.c_str());
+        status = 1;
+      } else
+        printf("%s %u\n", result.file.c_str(), result.ret);
+      if constexpr (DumpOptions::DumpTotalTime)
+        printf("total time: %4lfms (%llu instructions)\n", result.ms, result.instret);
+      instret += result.instret;
+      loadMs += result.loadMs;
+    }
+    LOG("batch:                %zu programs, %llu instructions in %.1lfms (%.1lf guest MIPS)\n",
+      files.size(), instret, ms, ms == 0 ? 0.0 : (f64)instret / ms / 1e3);
+    LOG("batch load:           %.1lfms summed over the programs\n", loadMs);
+    return status;
+  }
+
+  // stdin redirected from a file is mapped rather than read
   u64 time = clock();
   Executor executor;
-  printf("%d\n", executor.exec(std::cin));
+  executor.fuse = fuse;
+  if (!executor.initMem(ImageText::fromFd(0)) or !executor.runnableOn(engine))
+    return 1;
+  const u64 loaded = clock();
+
+  // sampled simulation: the exit value as usual, the estimates on stderr
+  if (sample) {
+    const SampledRun run = RunSampled(executor, sampling);
+    if (run.faulted)
+      return 1;
+    printf("%d\n", run.ret);
+    LOG("sampling:             %llu windows of %llu cycles every %llu instructions, %llu cycles in the pipeline\n",
+      run.samples, sampling.window, sampling.period, run.detailedCycles);
+    if (run.samples == 0)
+      LOG("sampling:             the program ended before a window was complete; nothing to estimate\n");
+    else {
+      LOG("estimated cycles:     %.0lf +- %.0lf (95%%, %llu instructions)\n", run.cycles().value, run.cycles().error,
+        run.instret);
+      LOG("estimated CPI:        %.4lf +- %.4lf\n", run.cpi.value, run.cpi.error);
+      LOG("estimated accuracy:   %.4lf%% +- %.4lf%%\n", run.accuracy.value * 100.0, run.accuracy.error * 100.0);
+    }
+    return 0;
+  }
+
+  // interval simulation: the exit value as usual, the stitched pipeline statistics on stderr
+  if (intervals) {
+    interval.jobs = jobs;
+    const IntervalRun run = RunIntervals(executor, interval);
+    if (run.faulted)
+      return 1;
+    printf("%d\n", run.ret);
+    LOG("intervals:            %llu of %llu instructions on %u threads, %llu bytes of checkpoints\n",
+      run.intervals, interval.length, jobs, run.checkpointBytes);
+    LOG("execution time:       %llu clock cycles (%llu instructions)\n", run.cycles, run.instret);
+    LOG("prediction accuracy:  %.6lf%% (%llu hits / %llu predictions in total)\n",
+      run.accuracy() * 100.0, run.hits, run.predictions);
+    return 0;
+  }
+
+  if (!checkpoint.empty())
+    executor.pauseAt = at;
+  const u32 ret = executor.run(engine);
+  if (executor.mem.fault)
+    return 1;
+
+  // paused at --at: save the state and stop; a program that halts first runs to the end as usual
+  if (!checkpoint.empty() and !executor.halted) {
+    const std::string state = WriteCheckpoint(executor);
+    FILE *out = fopen(checkpoint.c_str(), "wb");
+    const bool written = out != nullptr and fwrite(state.data(), 1, state.size(), out) == state.size();
+    if (out != nullptr)
+      fclose(out);
+    if (!written) {
+      LOG("cannot write %s\n", checkpoint.c_str());
+      return 1;
+    }
+    LOG("checkpoint:           %s at %llu %s, %zu bytes\n", checkpoint.c_str(), at,
+      engine == Engine::Pipeline ? "cycles" : "instructions", state.size());
+    return 0;
+  }
+  printf("%d\n", ret);
   if constexpr (DumpOptions::DumpTotalTime) {
     f64 totalTime = f64(clock() - time) / CLOCKS_PER_SEC;
-    printf("total time: %4lfms\n", totalTime * 1000);
+    f64 loadTime = f64(loaded - time) / CLOCKS_PER_SEC;
+    printf("total time: %4lfms (load %4lfms)\n", totalTime * 1000, loadTime * 1000);
   }
   return 0;
 }
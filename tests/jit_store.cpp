@@ -0,0 +1,93 @@
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+// A native store over code that was decoded before a block cache flush must
+// still invalidate it. The program calls F (addi a0, zero, 1), stores over
+// F's return, which flushes the translated blocks, then has a loop hot enough
+// to be compiled store addi a0, zero, 2 over F on its last iteration, and
+// calls F again. Every engine has to return 2.
+
+namespace {
+  constexpr u32 Zero = 0, Ra = 1, T0 = 5, T1 = 6, T2 = 7, A0 = 10, T3 = 28, T4 = 29, T5 = 30, T6 = 31;
+
+  auto I(const i32 imm, const u32 rs1, const u32 funct3, const u32 rd, const u32 opcode = 0x13) -> u32 {
+    return (static_cast<u32>(imm) & 0xfffu) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+  }
+  auto R(const u32 funct7, const u32 rs2, const u32 rs1, const u32 funct3, const u32 rd) -> u32 {
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | 0x33;
+  }
+  auto U(const u32 upper, const u32 rd) -> u32 { return upper << 12 | rd << 7 | 0x37; }
+  auto Sw(const u32 rs2, const u32 rs1) -> u32 { return rs2 << 20 | rs1 << 15 | 2u << 12 | 0x23; }
+  auto Bne(const i32 offset, const u32 rs1, const u32 rs2) -> u32 {
+    const u32 imm = static_cast<u32>(offset);
+    return (imm >> 12 & 1) << 31 | (imm >> 5 & 0x3f) << 25 | rs2 << 20 | rs1 << 15 | 1u << 12
+      | (imm >> 1 & 0xf) << 8 | (imm >> 11 & 1) << 7 | 0x63;
+  }
+  auto Jal(const i32 offset, const u32 rd) -> u32 {
+    const u32 imm = static_cast<u32>(offset);
+    return (imm >> 20 & 1) << 31 | (imm >> 1 & 0x3ff) << 21 | (imm >> 11 & 1) << 20 | (imm >> 12 & 0xff) << 12
+      | rd << 7 | 0x6f;
+  }
+
+  constexpr u32 F = 0x100, Scratch = 0x200;
+  constexpr u32 Ret = 0x00008067; // jalr zero, 0(ra)
+
+  /// the program as a hex image
+  auto Image() -> std::string {
+    const std::vector<u32> main = {
+      Jal(F - 0x00, Ra),                  // 0x00 call F, decoding it
+      I(F + 4, Zero, 0, T6),              // 0x04
+      U(Ret >> 12, T1),                   // 0x08
+      I(Ret & 0xfff, T1, 0, T1),          // 0x0c
+      Sw(T1, T6),                         // 0x10 the same word over F's return: flushes the blocks
+      I(Scratch, Zero, 0, T6),            // 0x14
+      I(F ^ Scratch, Zero, 0, T5),        // 0x18
+      U(0x00200513 >> 12, T1),            // 0x1c addi a0, zero, 2
+      I(0x00200513 & 0xfff, T1, 0, T1),   // 0x20
+      I(40, Zero, 0, T0),                 // 0x24
+      I(-1, T0, 0, T0),                   // 0x28 loop: stores to Scratch, and to F once t0 is 0
+      I(1, T0, 3, T3),                    // 0x2c sltiu
+      R(0x20, T3, Zero, 0, T3),           // 0x30 sub
+      R(0, T3, T5, 7, T4),                // 0x34 and
+      R(0, T4, T6, 4, T2),                // 0x38 xor
+      Sw(T1, T2),                         // 0x3c
+      Bne(0x28 - 0x40, T0, Zero),         // 0x40
+      Jal(F - 0x44, Ra),                  // 0x44 call F again
+      HaltEncoding,                       // 0x48
+    };
+    std::ostringstream out;
+    const auto words = [&](const u32 address, const std::vector<u32> &code) {
+      char line[16];
+      snprintf(line, sizeof line, "@%08X\n", address);
+      out << line;
+      for (const u32 word : code) {
+        for (u32 byte = 0; byte < 4; ++byte) {
+          snprintf(line, sizeof line, "%02X ", word >> (8 * byte) & 0xff);
+          out << line;
+        }
+        out << "\n";
+      }
+    };
+    words(0, main);
+    words(F, {I(1, Zero, 0, A0), Ret});
+    return out.str();
+  }
+}
+
+auto main() -> i32 {
+  u32 wrong = 0;
+  for (const auto &[name, engine] : {std::pair{"pipeline", Engine::Pipeline}, std::pair{"functional", Engine::Functional},
+                                     std::pair{"threaded", Engine::Threaded}, std::pair{"block", Engine::Block},
+                                     std::pair{"jit", Engine::Jit}}) {
+    auto executor = std::make_unique<Executor>();
+    std::istringstream input(Image());
+    const u32 ret = executor->exec(input, engine);
+    printf("%-10s %u\n", name, ret);
+    wrong += ret != 2;
+  }
+  return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+// Guest stores over code every engine has already decoded or translated: a
+// word further down the running block, a function that was called and
+// chained to, and a word of a loop body from within the loop. The pipeline
+// fetches the old words of the few instructions behind a store, so each
+// store is followed by enough nops for them to be the new ones. The program
+// returns 5 from the patched F, plus 7 from the patched word ahead, plus 34
+// from the loop (1 + 1 + 16 + 16); every engine has to return what the
+// pipeline does, 46.
+
+namespace {
+  constexpr u32 Zero = 0, Ra = 1, T0 = 5, T1 = 6, T2 = 7, A0 = 10, A1 = 11, A2 = 12, T6 = 31;
+
+  auto I(const i32 imm, const u32 rs1, const u32 funct3, const u32 rd, const u32 opcode = 0x13) -> u32 {
+    return (static_cast<u32>(imm) & 0xfffu) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+  }
+  auto R(const u32 funct7, const u32 rs2, const u32 rs1, const u32 funct3, const u32 rd) -> u32 {
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | 0x33;
+  }
+  auto U(const u32 upper, const u32 rd) -> u32 { return upper << 12 | rd << 7 | 0x37; }
+  auto Sw(const u32 rs2, const u32 rs1) -> u32 { return rs2 << 20 | rs1 << 15 | 2u << 12 | 0x23; }
+  auto Bne(const i32 offset, const u32 rs1, const u32 rs2) -> u32 {
+    const u32 imm = static_cast<u32>(offset);
+    return (imm >> 12 & 1) << 31 | (imm >> 5 & 0x3f) << 25 | rs2 << 20 | rs1 << 15 | 1u << 12
+      | (imm >> 1 & 0xf) << 8 | (imm >> 11 & 1) << 7 | 0x63;
+  }
+  auto Jal(const i32 offset, const u32 rd) -> u32 {
+    const u32 imm = static_cast<u32>(offset);
+    return (imm >> 20 & 1) << 31 | (imm >> 1 & 0x3ff) << 21 | (imm >> 11 & 1) << 20 | (imm >> 12 & 0xff) << 12
+      | rd << 7 | 0x6f;
+  }
+
+  constexpr u32 Ahead = 0x2c, Body = 0x74, F = 0x100;
+  constexpr u32 Nop = 0x00000013;   // addi zero, zero, 0
+  constexpr u32 Ret = 0x00008067;   // jalr zero, 0(ra)
+  constexpr u32 Expected = 46;
+
+  /// the program as a hex image
+  auto Image() -> std::string {
+    const u32 seven = I(7, Zero, 0, A1), five = I(5, Zero, 0, A0), sixteen = I(16, A2, 0, A2);
+    const std::vector<u32> main = {
+      Jal(F - 0x00, Ra),                  // 0x00 call F, translating it
+      U(seven >> 12, T1),                 // 0x04
+      I(seven & 0xfff, T1, 0, T1),        // 0x08
+      I(Ahead, Zero, 0, T6),              // 0x0c
+      Sw(T1, T6),                         // 0x10 addi a1, zero, 7 over a word further down this block
+      Nop, Nop, Nop, Nop, Nop, Nop,       // 0x14
+      I(3, Zero, 0, A1),                  // 0x2c
+      U(five >> 12, T1),                  // 0x30
+      I(five & 0xfff, T1, 0, T1),         // 0x34
+      I(F, Zero, 0, T6),                  // 0x38
+      Sw(T1, T6),                         // 0x3c addi a0, zero, 5 over F
+      Nop, Nop, Nop, Nop, Nop, Nop,       // 0x40
+      Jal(F - 0x58, Ra),                  // 0x58 call F again
+      I(4, Zero, 0, T0),                  // 0x5c
+      I(2, Zero, 0, T1),                  // 0x60
+      U(sixteen >> 12, T2),               // 0x64
+      I(sixteen & 0xfff, T2, 0, T2),      // 0x68
+      I(Body, Zero, 0, T6),               // 0x6c
+      I(0, Zero, 0, A2),                  // 0x70
+      I(1, A2, 0, A2),                    // 0x74 loop: adds 1, then 16 once rewritten
+      I(-1, T0, 0, T0),                   // 0x78
+      Bne(0x84 - 0x7c, T0, T1),           // 0x7c
+      Sw(T2, T6),                         // 0x80 addi a2, a2, 16 over the loop's first word, when t0 is 2
+      Nop, Nop, Nop, Nop, Nop, Nop,       // 0x84
+      Bne(Body - 0x9c, T0, Zero),         // 0x9c
+      R(0, A1, A0, 0, A0),                // 0xa0
+      R(0, A2, A0, 0, A0),                // 0xa4
+      HaltEncoding,                       // 0xa8
+    };
+    std::ostringstream out;
+    const auto words = [&](const u32 address, const std::vector<u32> &code) {
+      char line[16];
+      snprintf(line, sizeof line, "@%08X\n", address);
+      out << line;
+      for (const u32 word : code) {
+        for (u32 byte = 0; byte < 4; ++byte) {
+          snprintf(line, sizeof line, "%02X ", word >> (8 * byte) & 0xff);
+          out << line;
+        }
+        out << "\n";
+      }
+    };
+    words(0, main);
+    words(F, {I(1, Zero, 0, A0), Ret});
+    return out.str();
+  }
+}
+
+auto main() -> i32 {
+  u32 wrong = 0, pipeline = 0;
+  for (const auto &[name, engine] : {std::pair{"pipeline", Engine::Pipeline}, std::pair{"functional", Engine::Functional},
+                                     std::pair{"threaded", Engine::Threaded}, std::pair{"block", Engine::Block},
+                                     std::pair{"jit", Engine::Jit}}) {
+    auto executor = std::make_unique<Executor>();
+    std::istringstream input(Image());
+    const u32 ret = executor->exec(input, engine);
+    printf("%-10s %u\n", name, ret);
+    if (engine == Engine::Pipeline)
+      pipeline = ret;
+    wrong += ret != pipeline or ret != Expected;
+  }
+  return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+#include "config.hpp"
+#include "Executor.hpp"
+
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+// Ahead-of-time translator: turns a program image into a standalone C++ program
+// that returns the same value as Executor::exec.
+//
+//   aot [-o program.cpp] [program.data|program.elf]
+//
+// Code is recovered by following control flow from the entry point with the
+// same block translator as the block engine. Roots are the entry point, the
+// functions of an ELF symbol table, return sites after every JAL / JALR,
+// constants built by LUI / AUIPC (+ ADDI) within a block and image words
+// pointing into recovered code (jump tables). Every block
+// becomes a label; JALR jumps go through a switch over every block start.
+// The generated program keeps guest memory in pages allocated on first use,
+// as Memory does, and stops with a report if it stores into translated
+// code or jumps somewhere no block was recovered for.
+
+namespace {
+  using ID = InstTag::ID;
+
+  struct Translator {
+    Executor &executor;
+    std::map<u32, Block *> blocks;  // every recovered block by start pc
+    std::set<u32> code;             // addresses of every recovered instruction
+    std::set<u32> constants;        // addresses materialized by LUI / AUIPC (+ ADDI)
+
+    auto valid(const u32 pc) const -> bool { return pc < CODE_SIZE and pc % 4 == 0; }
+
+    /// translate everything reachable from `roots`
+    auto recover(std::vector<u32> roots) -> void {
+      while (!roots.empty()) {
+        const u32 start = roots.back();
+        roots.pop_back();
+        if (!valid(start) or blocks.count(start))
+          continue;
+
+        Block *block = executor.blockCache.lookup(start);
+        if (block == nullptr)
+          block = executor.translateBlock(start);
+        blocks.emplace(start, block);
+        if (block->halt) {
+          code.insert(start);
+          continue;
+        }
+
+        // registers holding known values inside the block
+        std::map<u32, u32> known;
+        u32 pc = start;
+        for (const Block::Op &op : block->ops) {
+          code.insert(pc);
+          const MicroOp *inst = op.inst;
+          const auto value = [&](const u32 reg) -> const u32 * {
+            const auto found = known.find(reg);
+            return reg == 0 ? &Zero : found == known.end() ? nullptr : &found->second;
+          };
+
+          std::optional<u32> result;
+          if (inst->kind == ID::LUI)
+            result = inst->imm;
+          else if (inst->kind == ID::AUIPC)
+            result = pc + inst->imm;
+          else if (inst->kind == ID::ADDI and value(inst->rs1))
+            result = *value(inst->rs1) + inst->imm;
+
+          switch (inst->kind) {
+          case ID::JAL:
+            roots.push_back(pc + inst->imm);
+            if (inst->rd != 0)
+              roots.push_back(pc + 4);
+            break;
+          case ID::JALR:
+            if (const u32 *base = value(inst->rs1))
+              roots.push_back((*base + inst->imm) & ~1u);
+            if (inst->rd != 0)
+              roots.push_back(pc + 4);
+            break;
+          case ID::BEQ: case ID::BNE: case ID::BLT: case ID::BLTU: case ID::BGE: case ID::BGEU:
+            roots.push_back(pc + inst->imm);
+            roots.push_back(pc + 4);
+            break;
+          default:
+            break;
+          }
+
+          if (result) {
+            constants.insert(*result);
+            known[inst->rd] = *result;
+          } else if (inst->kind != ID::Unknown and !InstTag::IsStore(inst->kind) and !InstTag::IsBranch(inst->kind)) {
+            known.erase(inst->rd);
+          }
+          pc += 4;
+        }
+
+        if (!InstTag::IsControl(block->ops.back().inst->kind))
+          roots.push_back(block->end);
+      }
+    }
+
+    /// addresses inside recovered code that something in the image points at
+    auto pointers() const -> std::vector<u32> {
+      std::vector<u32> found;
+      for (const u32 constant : constants)
+        if (code.count(constant) and !blocks.count(constant))
+          found.push_back(constant);
+      for (const u32 number : executor.mem.touched)
+        for (u32 offset = 0; offset < Memory::PageSize; offset += 4) {
+          const u32 word = executor.mem.load<u32>((number << Memory::PageBits) + offset);
+          if (word != 0 and code.count(word) and !blocks.count(word))
+            found.push_back(word);
+        }
+      return found;
+    }
+
+    auto run() -> void {
+      std::vector<u32> roots{executor.program.entry};
+      for (const Symbol &symbol : executor.program.symbols)
+        if (symbol.function and symbol.value < CODE_SIZE)
+          roots.push_back(symbol.value);
+      recover(std::move(roots));
+      for (std::vector<u32> more = pointers(); !more.empty(); more = pointers())
+        recover(std::move(more));
+    }
+
+    static constexpr u32 Zero = 0;
+  };
+
+  struct Emitter {
+    FILE *out;
+    const Translator &translator;
+
+    auto jump(const u32 target) const -> void {
+      if (translator.blocks.count(target))
+        fprintf(out, "goto B_%05x;", target);
+      else
+        fprintf(out, "fault(\"jump to unrecovered code\", 0x%xu);", target);
+    }
+
+    auto write(const u32 rd, const char *expr, const u32 a = 0, const u32 b = 0) const -> void {
+      if (rd == 0) {
+        fprintf(out, "/* x0 */");
+        return;
+      }
+      fprintf(out, "x[%u] = ", rd);
+      fprintf(out, expr, a, b);
+      fprintf(out, ";");
+    }
+
+    auto inst(const MicroOp *inst, const u32 pc) const -> void {
+      const u32 rd = inst->rd, rs1 = inst->rs1, rs2 = inst->rs2, imm = inst->imm;
+      fprintf(out, "  /* %05x */ ", pc);
+      const auto branch = [&](const char *cond) {
+        fprintf(out, "if (");
+        fprintf(out, cond, rs1, rs2);
+        fprintf(out, ") ");
+        jump(pc + imm);
+        fprintf(out, " ");
+        jump(pc + 4);
+      };
+
+      switch (inst->kind) {
+      case ID::ADDI:  write(rd, "x[%u] + 0x%xu", rs1, imm); break;
+      case ID::SLTI:  write(rd, "i32(x[%u]) < i32(0x%xu)", rs1, imm); break;
+      case ID::SLTIU: write(rd, "x[%u] < 0x%xu", rs1, imm); break;
+      case ID::ANDI:  write(rd, "x[%u] & 0x%xu", rs1, imm); break;
+      case ID::ORI:   write(rd, "x[%u] | 0x%xu", rs1, imm); break;
+      case ID::XORI:  write(rd, "x[%u] ^ 0x%xu", rs1, imm); break;
+      case ID::SLLI:  write(rd, "x[%u] << %u", rs1, imm & 31u); break;
+      case ID::SRLI:  write(rd, "x[%u] >> %u", rs1, imm & 31u); break;
+      case ID::SRAI:  write(rd, "u32(i32(x[%u]) >> %u)", rs1, imm & 31u); break;
+      case ID::LUI:   write(rd, "0x%xu", imm); break;
+      case ID::AUIPC: write(rd, "0x%xu", pc + imm); break;
+      case ID::ADD:   write(rd, "x[%u] + x[%u]", rs1, rs2); break;
+      case ID::SUB:   write(rd, "x[%u] - x[%u]", rs1, rs2); break;
+      case ID::SLT:   write(rd, "i32(x[%u]) < i32(x[%u])", rs1, rs2); break;
+      case ID::SLTU:  write(rd, "x[%u] < x[%u]", rs1, rs2); break;
+      case ID::AND:   write(rd, "x[%u] & x[%u]", rs1, rs2); break;
+      case ID::OR:    write(rd, "x[%u] | x[%u]", rs1, rs2); break;
+      case ID::XOR:   write(rd, "x[%u] ^ x[%u]", rs1, rs2); break;
+      case ID::SLL:   write(rd, "x[%u] << (x[%u] & 31)", rs1, rs2); break;
+      case ID::SRL:   write(rd, "x[%u] >> (x[%u] & 31)", rs1, rs2); break;
+      case ID::SRA:   write(rd, "u32(i32(x[%u]) >> (x[%u] & 31))", rs1, rs2); break;
+      // loads are performed even into x0, so that they fault the same way
+      case ID::LB:    fprintf(out, "t = u32(i32(load<i8>(x[%u] + 0x%xu))); ", rs1, imm);  write(rd, "t"); break;
+      case ID::LH:    fprintf(out, "t = u32(i32(load<i16>(x[%u] + 0x%xu))); ", rs1, imm); write(rd, "t"); break;
+      case ID::LW:    fprintf(out, "t = load<u32>(x[%u] + 0x%xu); ", rs1, imm);           write(rd, "t"); break;
+      case ID::LBU:   fprintf(out, "t = load<u8>(x[%u] + 0x%xu); ", rs1, imm);            write(rd, "t"); break;
+      case ID::LHU:   fprintf(out, "t = load<u16>(x[%u] + 0x%xu); ", rs1, imm);           write(rd, "t"); break;
+      case ID::SB:    fprintf(out, "store<u8>(x[%u] + 0x%xu, u8(x[%u]));", rs1, imm, rs2); break;
+      case ID::SH:    fprintf(out, "store<u16>(x[%u] + 0x%xu, u16(x[%u]));", rs1, imm, rs2); break;
+      case ID::SW:    fprintf(out, "store<u32>(x[%u] + 0x%xu, x[%u]);", rs1, imm, rs2); break;
+      case ID::BEQ:   branch("x[%u] == x[%u]"); break;
+      case ID::BNE:   branch("x[%u] != x[%u]"); break;
+      case ID::BLT:   branch("i32(x[%u]) < i32(x[%u])"); break;
+      case ID::BLTU:  branch("x[%u] < x[%u]"); break;
+      case ID::BGE:   branch("i32(x[%u]) >= i32(x[%u])"); break;
+      case ID::BGEU:  branch("x[%u] >= x[%u]"); break;
+      case ID::JAL:
+        write(rd, "0x%xu", pc + 4);
+        fprintf(out, " ");
+        jump(pc + imm);
+        break;
+      case ID::JALR:
+        fprintf(out, "npc = (x[%u] + 0x%xu) & ~1u; ", rs1, imm);
+        write(rd, "0x%xu", pc + 4);
+        fprintf(out, " goto dispatch;");
+        break;
+      default:
+        fprintf(out, "/* unknown instruction %08x */", inst->encoding);
+        break;
+      }
+      fprintf(out, "\n");
+    }
+
+    auto program(const Memory &mem) const -> void {
+      fprintf(out,
+        "// generated by aot from a RISC-V .data image, do not edit\n"
+        "#include <cstdint>\n"
+        "#include <cstdio>\n"
+        "#include <cstdlib>\n"
+        "#include <cstring>\n"
+        "\n"
+        "using u8 = uint8_t; using u16 = uint16_t; using u32 = uint32_t;\n"
+        "using i8 = int8_t; using i16 = int16_t; using i32 = int32_t;\n"
+        "\n"
+        "// guest memory in 4 KiB pages, allocated on first use\n"
+        "static u8 *pages[1u << 20];\n"
+        "\n");
+
+      // translated code, as [begin, end) ranges of words
+      fprintf(out, "static const u32 code[][2] = {\n");
+      for (auto it = translator.code.begin(); it != translator.code.end();) {
+        const u32 begin = *it;
+        u32 end = begin + 4;
+        for (++it; it != translator.code.end() and *it == end; ++it)
+          end += 4;
+        fprintf(out, "  {0x%05xu, 0x%05xu},\n", begin, end);
+      }
+      fprintf(out, "};\n\n");
+
+      fprintf(out,
+        "[[noreturn]] static void fault(const char *what, u32 address) {\n"
+        "  fprintf(stderr, \"%%s: 0x%%08x\\n\", what, address);\n"
+        "  abort();\n"
+        "}\n"
+        "\n"
+        "static inline u8 *byte(u32 address) {\n"
+        "  u8 *&page = pages[address >> 12];\n"
+        "  if (page == nullptr and (page = (u8 *)calloc(1, 4096)) == nullptr) fault(\"out of memory\", address);\n"
+        "  return page + (address & 4095);\n"
+        "}\n"
+        "\n"
+        "static void copy(u32 address, const void *data, u32 size) {\n"
+        "  for (u32 i = 0; i < size; ++i) *byte(address + i) = ((const u8 *)data)[i];\n"
+        "}\n"
+        "\n"
+        "template <typename T> static inline T load(u32 address) {\n"
+        "  T value;\n"
+        "  if ((address & 4095) <= 4096 - sizeof value) memcpy(&value, byte(address), sizeof value);\n"
+        "  else for (u32 i = 0; i < sizeof value; ++i) ((u8 *)&value)[i] = *byte(address + i);\n"
+        "  return value;\n"
+        "}\n"
+        "\n"
+        "template <typename T> static inline void store(u32 address, T value) {\n"
+        "  if (address < code[sizeof code / sizeof *code - 1][1])\n"
+        "    for (const auto &range : code)\n"
+        "      if (address < range[1] and address + sizeof value > range[0])\n"
+        "        fault(\"store into translated code\", address);\n"
+        "  if ((address & 4095) <= 4096 - sizeof value) memcpy(byte(address), &value, sizeof value);\n"
+        "  else copy(address, &value, sizeof value);\n"
+        "}\n"
+        "\n");
+
+      // nonzero extents, merging gaps shorter than a line of output
+      const std::vector<SnapshotExtent> extents = NonzeroExtents(mem, 16);
+      for (const auto &[begin, size] : extents) {
+        fprintf(out, "static const u8 image_%05x[] = {", begin);
+        for (u32 offset = 0; offset < size; ++offset)
+          fprintf(out, "%s%u,", offset % 32 == 0 ? "\n  " : "", mem.load<u8>(begin + offset));
+        fprintf(out, "\n};\n");
+      }
+
+      fprintf(out, "\nint main() {\n");
+      for (const auto &[begin, size] : extents)
+        fprintf(out, "  copy(0x%05xu, image_%05x, sizeof image_%05x);\n", begin, begin, begin);
+      fprintf(out, "  u32 x[32] = {0};\n  u32 npc = 0, t = 0;\n  (void)t;\n  goto B_%05x;\n\n",
+        translator.executor.program.entry);
+
+      for (const auto &[start, block] : translator.blocks) {
+        fprintf(out, "B_%05x:\n", start);
+        if (block->halt) {
+          fprintf(out, "  goto halt;\n");
+          continue;
+        }
+        u32 pc = start;
+        for (const Block::Op &op : block->ops) {
+          inst(op.inst, pc);
+          pc += 4;
+        }
+        if (!InstTag::IsControl(block->ops.back().inst->kind)) {
+          fprintf(out, "  ");
+          jump(block->end);
+          fprintf(out, "\n");
+        }
+      }
+
+      fprintf(out, "\ndispatch:\n  switch (npc) {\n");
+      for (const auto &[start, block] : translator.blocks)
+        fprintf(out, "  case 0x%05xu: goto B_%05x;\n", start, start);
+      fprintf(out,
+        "  default: fault(\"jump to unrecovered code\", npc);\n"
+        "  }\n"
+        "\n"
+        "halt:\n"
+        "  printf(\"%%u\\n\", x[10] & 255u);\n"
+        "  return int(x[10] & 255u);\n"
+        "}\n");
+    }
+  };
+}
+
+auto main(i32 argc, char **argv) -> i32 {
+  std::string input, output;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-o" and i + 1 < argc)
+      output = argv[++i];
+    else if (arg[0] != '-' and input.empty())
+      input = arg;
+    else {
+      LOG("usage: %s [-o program.cpp] [program.data|program.elf]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  auto executor = std::make_unique<Executor>();
+  if (input.empty()) {
+    if (!executor->initMem(ImageText::fromFd(0)))
+      return 1;
+  } else {
+    const std::optional<ImageText> text = ImageText::open(input.c_str());
+    if (!text) {
+      LOG("cannot open %s\n", input.c_str());
+      return 1;
+    }
+    if (!executor->initMem(*text))
+      return 1;
+  }
+  if (executor->restored) {
+    LOG("%s translates program images, not checkpoints\n", argv[0]);
+    return 1;
+  }
+
+  Translator translator{*executor, {}, {}, {}};
+  translator.run();
+
+  FILE *out = output.empty() ? stdout : fopen(output.c_str(), "w");
+  if (out == nullptr) {
+    LOG("cannot open %s\n", output.c_str());
+    return 1;
+  }
+  Emitter{out, translator}.program(executor->mem);
+  if (out != stdout)
+    fclose(out);
+
+  LOG("aot: %zu blocks, %zu instructions\n", translator.blocks.size(), translator.code.size());
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include "config.hpp"
+#include "Executor.hpp"
+
+// Snapshot writer: loads a program image the way ./code does and saves the
+// resulting memory as a snapshot (Snapshot.hpp), which ./code, batch mode
+// and --lockstep load with one copy per nonzero extent.
+//
+//   snapshot [-o program.snap] [program.data|program.elf]
+//
+// reads stdin and writes stdout by default.
+
+auto main(i32 argc, char **argv) -> i32 {
+  std::string input, output;
+  for (i32 i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-o" and i + 1 < argc)
+      output = argv[++i];
+    else if (arg[0] != '-' and input.empty())
+      input = arg;
+    else {
+      LOG("usage: %s [-o program.snap] [program.data|program.elf]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  auto executor = std::make_unique<Executor>();
+  if (input.empty()) {
+    if (!executor->initMem(ImageText::fromFd(0)))
+      return 1;
+  } else {
+    const std::optional<ImageText> text = ImageText::open(input.c_str());
+    if (!text) {
+      LOG("cannot open %s\n", input.c_str());
+      return 1;
+    }
+    if (!executor->initMem(*text))
+      return 1;
+  }
+  if (executor->restored) {
+    LOG("%s saves program images, not checkpoints\n", argv[0]);
+    return 1;
+  }
+
+  const std::string snapshot = WriteSnapshot(executor->mem, executor->program.entry);
+  FILE *out = output.empty() ? stdout : fopen(output.c_str(), "wb");
+  if (out == nullptr) {
+    LOG("cannot open %s\n", output.c_str());
+    return 1;
+  }
+  const bool written = fwrite(snapshot.data(), 1, snapshot.size(), out) == snapshot.size();
+  if (out != stdout)
+    fclose(out);
+  if (!written) {
+    LOG("cannot write %s\n", output.empty() ? "stdout" : output.c_str());
+    return 1;
+  }
+  LOG("snapshot: %u extents, %zu bytes\n", static_cast<u32>(NonzeroExtents(executor->mem).size()), snapshot.size());
+  return 0;
+}